@@ -0,0 +1,237 @@
+#include "AudioEngine.h"
+#include <algorithm>
+#include <cmath>
+
+static constexpr float pi = 3.14159265f;
+
+static void addTone(SampleBuffer& buffer, float startSeconds, float seconds, float startHz, float endHz,
+    float amplitude, float decay) {
+    size_t start = static_cast<size_t>(startSeconds * buffer.sampleRate);
+    size_t length = static_cast<size_t>(seconds * buffer.sampleRate);
+    if (buffer.samples.size() < start + length) {
+        buffer.samples.resize(start + length, 0);
+    }
+
+    float phase = 0.0f;
+    for (size_t i = 0; i < length; i++) {
+        float t = static_cast<float>(i) / static_cast<float>(length);
+        float hz = startHz + (endHz - startHz) * t;
+        phase += 2.0f * pi * hz / static_cast<float>(buffer.sampleRate);
+
+        float attack = std::min(1.0f, static_cast<float>(i) / 64.0f);
+        float value = std::sin(phase) * amplitude * attack * std::exp(-decay * t);
+        int mixed = buffer.samples[start + i] + static_cast<int>(value * 32767.0f);
+        buffer.samples[start + i] = static_cast<int16_t>(std::clamp(mixed, -32768, 32767));
+    }
+}
+
+static void addNoise(SampleBuffer& buffer, float seconds, float amplitude, float decay) {
+    size_t length = static_cast<size_t>(seconds * buffer.sampleRate);
+    if (buffer.samples.size() < length) {
+        buffer.samples.resize(length, 0);
+    }
+
+    SimRng noise(0xB0B0ull);
+    float smoothed = 0.0f;
+    for (size_t i = 0; i < length; i++) {
+        float t = static_cast<float>(i) / static_cast<float>(length);
+        float white = static_cast<float>(noise() >> 16) / 32768.0f - 1.0f;
+        smoothed += (white - smoothed) * 0.2f;
+
+        float value = smoothed * amplitude * std::exp(-decay * t);
+        int mixed = buffer.samples[i] + static_cast<int>(value * 32767.0f);
+        buffer.samples[i] = static_cast<int16_t>(std::clamp(mixed, -32768, 32767));
+    }
+}
+
+SampleBuffer AudioEngine::synthesize(SoundCue cue) {
+    SampleBuffer buffer;
+
+    switch (cue) {
+    case CUE_POP:
+        addTone(buffer, 0.0f, 0.09f, 900.0f, 420.0f, 0.5f, 5.0f);
+        break;
+    case CUE_BOMB:
+        addNoise(buffer, 0.45f, 0.8f, 6.0f);
+        addTone(buffer, 0.0f, 0.45f, 90.0f, 40.0f, 0.6f, 4.0f);
+        break;
+    case CUE_RAINBOW:
+        addTone(buffer, 0.00f, 0.12f, 523.0f, 523.0f, 0.35f, 3.0f);
+        addTone(buffer, 0.07f, 0.12f, 659.0f, 659.0f, 0.35f, 3.0f);
+        addTone(buffer, 0.14f, 0.12f, 784.0f, 784.0f, 0.35f, 3.0f);
+        addTone(buffer, 0.21f, 0.20f, 1047.0f, 1047.0f, 0.35f, 3.0f);
+        break;
+    case CUE_LEVEL_COMPLETE:
+        addTone(buffer, 0.00f, 0.25f, 392.0f, 392.0f, 0.3f, 2.0f);
+        addTone(buffer, 0.15f, 0.25f, 523.0f, 523.0f, 0.3f, 2.0f);
+        addTone(buffer, 0.30f, 0.25f, 659.0f, 659.0f, 0.3f, 2.0f);
+        addTone(buffer, 0.45f, 0.60f, 784.0f, 784.0f, 0.3f, 2.5f);
+        addTone(buffer, 0.45f, 0.60f, 523.0f, 523.0f, 0.2f, 2.5f);
+        break;
+    default:
+        break;
+    }
+    return buffer;
+}
+
+int AudioEngine::voicesFor(SoundCue cue) {
+    switch (cue) {
+    case CUE_POP: return 6;
+    case CUE_BOMB: return 2;
+    case CUE_RAINBOW: return 2;
+    default: return 1;
+    }
+}
+
+bool AudioEngine::init(AudioBackend& audioBackend) {
+    for (int i = 0; i < CUE_COUNT; i++) {
+        SoundCue cue = static_cast<SoundCue>(i);
+        int voices = std::min(voicesFor(cue), maxVoicesPerCue);
+
+        if (!audioBackend.loadCue(cue, synthesize(cue), voices)) {
+            audioBackend.unload();
+            return false;
+        }
+        pools[static_cast<size_t>(i)] = CuePool{};
+        pools[static_cast<size_t>(i)].voices = voices;
+    }
+
+    backend = &audioBackend;
+    return true;
+}
+
+void AudioEngine::shutdown() {
+    if (!backend) return;
+
+    backend->unload();
+    backend = nullptr;
+}
+
+void AudioEngine::queue(const SimEvent& event) {
+    if (!backend) return;
+
+    switch (event.type) {
+    case EVENT_POP:
+        // Bomb and rainbow victims are covered by their own cue.
+        if (event.source == EVENT_MATCH) {
+            pools[CUE_POP].pending++;
+            pools[CUE_POP].pendingWeight++;
+        }
+        break;
+    case EVENT_BOMB:
+        pools[CUE_BOMB].pending++;
+        pools[CUE_BOMB].pendingWeight += event.count;
+        break;
+    case EVENT_RAINBOW:
+        pools[CUE_RAINBOW].pending++;
+        pools[CUE_RAINBOW].pendingWeight += event.count;
+        break;
+    case EVENT_LEVEL_COMPLETE:
+        pools[CUE_LEVEL_COMPLETE].pending++;
+        break;
+    default:
+        break;
+    }
+}
+
+int AudioEngine::acquireVoice(SoundCue cue) {
+    CuePool& pool = pools[cue];
+
+    int oldest = 0;
+    for (int voice = 0; voice < pool.voices; voice++) {
+        if (!backend->isPlaying(cue, voice)) return voice;
+        if (pool.startedAt[static_cast<size_t>(voice)] < pool.startedAt[static_cast<size_t>(oldest)]) {
+            oldest = voice;
+        }
+    }
+
+    stats.stolen++;
+    return oldest;
+}
+
+void AudioEngine::trigger(SoundCue cue, int weight) {
+    int voice = acquireVoice(cue);
+    pools[cue].startedAt[static_cast<size_t>(voice)] = frame;
+
+    float volume = std::min(1.0f, 0.6f + 0.05f * static_cast<float>(weight)) * masterVolume;
+    float pitch = 1.0f;
+    if (cue == CUE_POP) {
+        pitch = 0.9f + static_cast<float>(rng() % 25) / 100.0f;
+    }
+
+    backend->play(cue, voice, volume, pitch);
+    stats.triggers++;
+}
+
+void AudioEngine::update() {
+    if (!backend) return;
+
+    frame++;
+    backend->update();
+
+    for (int i = 0; i < CUE_COUNT; i++) {
+        SoundCue cue = static_cast<SoundCue>(i);
+        CuePool& pool = pools[cue];
+        if (pool.pending == 0) continue;
+
+        int limit = cue == CUE_POP ? maxPopVoicesPerFrame : pool.voices;
+        int plays = std::min(pool.pending, limit);
+        int weight = pool.pendingWeight / plays;
+
+        for (int play = 0; play < plays; play++) {
+            trigger(cue, weight);
+        }
+        stats.coalesced += static_cast<uint32_t>(pool.pending - plays);
+
+        pool.pending = 0;
+        pool.pendingWeight = 0;
+    }
+}
+
+bool NullAudioBackend::loadCue(SoundCue cue, const SampleBuffer& pcm, int voices) {
+    if (pcm.samples.empty() || voices <= 0 || voices > maxVoices) return false;
+
+    CueStats& entry = cues[cue];
+    entry = CueStats{};
+    entry.voices = voices;
+    entry.sampleFrames = static_cast<uint32_t>(pcm.samples.size());
+    entry.sampleRate = pcm.sampleRate;
+    loads++;
+    return true;
+}
+
+void NullAudioBackend::play(SoundCue cue, int voice, float volume, float pitch) {
+    CueStats& entry = cues[cue];
+    uint32_t updates = entry.sampleFrames * 60 / entry.sampleRate + 1;
+    entry.remainingUpdates[static_cast<size_t>(voice)] = static_cast<uint32_t>(static_cast<float>(updates) / pitch);
+    entry.lastVolume = volume;
+    entry.plays++;
+    entry.peakActive = std::max(entry.peakActive, activeVoices(cue));
+}
+
+bool NullAudioBackend::isPlaying(SoundCue cue, int voice) const {
+    return cues[cue].remainingUpdates[static_cast<size_t>(voice)] > 0;
+}
+
+void NullAudioBackend::update() {
+    for (CueStats& entry : cues) {
+        for (uint32_t& remaining : entry.remainingUpdates) {
+            if (remaining > 0) remaining--;
+        }
+    }
+}
+
+void NullAudioBackend::unload() {
+    for (CueStats& entry : cues) {
+        entry.voices = 0;
+        entry.remainingUpdates.fill(0);
+    }
+}
+
+int NullAudioBackend::activeVoices(SoundCue cue) const {
+    int active = 0;
+    for (int voice = 0; voice < cues[cue].voices; voice++) {
+        if (isPlaying(cue, voice)) active++;
+    }
+    return active;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "SimCore.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+enum SoundCue {
+    CUE_POP,
+    CUE_BOMB,
+    CUE_RAINBOW,
+    CUE_LEVEL_COMPLETE,
+    CUE_COUNT
+};
+
+// Mono 16-bit PCM kept resident for the lifetime of the engine.
+struct SampleBuffer {
+    std::vector<int16_t> samples;
+    unsigned int sampleRate = 22050;
+};
+
+// Playback device behind the engine. Every cue is loaded once with a fixed
+// number of voices; play() always names a voice that was loaded.
+class AudioBackend {
+public:
+    virtual ~AudioBackend() = default;
+
+    virtual bool loadCue(SoundCue cue, const SampleBuffer& pcm, int voices) = 0;
+    virtual void play(SoundCue cue, int voice, float volume, float pitch) = 0;
+    virtual bool isPlaying(SoundCue cue, int voice) const = 0;
+    virtual void update() {
+    }
+    virtual void unload() = 0;
+};
+
+// Backend without a device. A voice stays busy for the length of its sample
+// at 60 updates per second, so tests can observe pooling and stealing.
+class NullAudioBackend : public AudioBackend {
+public:
+    static constexpr int maxVoices = 16;
+
+    struct CueStats {
+        int voices = 0;
+        int plays = 0;
+        int peakActive = 0;
+        uint32_t sampleFrames = 0;
+        unsigned int sampleRate = 0;
+        float lastVolume = 0.0f;
+        std::array<uint32_t, maxVoices> remainingUpdates{};
+    };
+
+    std::array<CueStats, CUE_COUNT> cues{};
+    int loads = 0;
+
+    bool loadCue(SoundCue cue, const SampleBuffer& pcm, int voices) override;
+    void play(SoundCue cue, int voice, float volume, float pitch) override;
+    bool isPlaying(SoundCue cue, int voice) const override;
+    void update() override;
+    void unload() override;
+
+    int activeVoices(SoundCue cue) const;
+};
+
+// Turns gameplay events into sound cues. Samples are synthesized and handed
+// to the backend once in init(); after that queue() and update() touch only
+// fixed-size state. Pops of one frame are folded into a few voices, and a
+// cue with no free voice steals its oldest one.
+class AudioEngine {
+public:
+    struct Stats {
+        uint32_t triggers = 0;
+        uint32_t stolen = 0;
+        uint32_t coalesced = 0;
+    };
+
+private:
+    static constexpr int maxVoicesPerCue = 8;
+    static constexpr int maxPopVoicesPerFrame = 3;
+
+    struct CuePool {
+        int voices = 0;
+        std::array<uint32_t, maxVoicesPerCue> startedAt{};
+        int pending = 0;
+        int pendingWeight = 0;
+    };
+
+    AudioBackend* backend = nullptr;
+    std::array<CuePool, CUE_COUNT> pools{};
+    SimRng rng{ 0xA0D10ull };
+    uint32_t frame = 0;
+    float masterVolume = 1.0f;
+    Stats stats;
+
+    void trigger(SoundCue cue, int weight);
+    int acquireVoice(SoundCue cue);
+
+public:
+    static SampleBuffer synthesize(SoundCue cue);
+    static int voicesFor(SoundCue cue);
+
+    bool init(AudioBackend& audioBackend);
+    void shutdown();
+
+    void queue(const SimEvent& event);
+    void update();
+
+    void setMasterVolume(float volume) {
+        masterVolume = volume;
+    }
+
+    bool isReady() const {
+        return backend != nullptr;
+    }
+
+    const Stats& getStats() const {
+        return stats;
+    }
+};
@@ -0,0 +1,113 @@
+#include "BoardGenerator.h"
+#include <array>
+#include <utility>
+
+static constexpr uint8_t outsidePalette = 31;
+
+// Population count and k-th set bit for every palette mask, so picking a
+// colour is two lookups instead of two data-dependent loops.
+struct PaletteSelect {
+    std::array<uint8_t, 1u << ballPalette.size()> count{};
+    std::array<std::array<uint8_t, ballPalette.size()>, 1u << ballPalette.size()> bit{};
+
+    PaletteSelect() {
+        for (uint32_t mask = 0; mask < count.size(); mask++) {
+            for (uint32_t i = 0; i < ballPalette.size(); i++) {
+                if (mask & (1u << i)) {
+                    bit[mask][count[mask]++] = static_cast<uint8_t>(i);
+                }
+            }
+        }
+    }
+};
+
+static const PaletteSelect paletteSelect;
+
+static BallColor pickColor(uint32_t mask, SimRng& rng) {
+    uint32_t choice = static_cast<uint32_t>((static_cast<uint64_t>(rng()) * paletteSelect.count[mask]) >> 32);
+    return paletteSelect.bit[mask][choice];
+}
+
+uint16_t BoardGenerator::findGroup(uint16_t cell) {
+    while (parent[cell] != cell) {
+        parent[cell] = parent[parent[cell]];
+        cell = parent[cell];
+    }
+    return cell;
+}
+
+void BoardGenerator::joinGroups(uint16_t a, uint16_t b) {
+    a = findGroup(a);
+    b = findGroup(b);
+    if (a == b) return;
+
+    if (groupSize[a] < groupSize[b]) std::swap(a, b);
+    parent[b] = a;
+    groupSize[a] = static_cast<uint8_t>(groupSize[a] + groupSize[b]);
+}
+
+bool BoardGenerator::generate(const BoardSpec& spec, SimRng& rng, ColorGrid& grid) {
+    if (spec.rows <= 0 || spec.columns <= 0 || spec.rows * spec.columns > maxCells) return false;
+    if (spec.colorCount < 3 || spec.colorCount > static_cast<int>(ballPalette.size())) return false;
+    if (spec.maxGroup < 1 || spec.maxGroup > 255) return false;
+    if (grid.columns != spec.columns || grid.cells.size() != static_cast<size_t>(spec.rows * spec.columns)) return false;
+
+    BallColor specials[3];
+    int specialKinds = 0;
+    if (spec.allowUniversal) specials[specialKinds++] = colorUniversalFlag;
+    if (spec.allowBomb) specials[specialKinds++] = colorBomb;
+    if (spec.allowRainbow) specials[specialKinds++] = colorRainbowFlag;
+    uint32_t specialPercent = specialKinds > 0 ? static_cast<uint32_t>(spec.specialPercent) : 0;
+
+    // One extra entry past the last cell stands in for a missing neighbour.
+    // It and every special are groups of size zero with a colour outside the
+    // palette, so the mask below needs no edge or special cases.
+    size_t cells = grid.cells.size();
+    parent.resize(cells + 1);
+    groupSize.resize(cells + 1);
+    groupColor.resize(cells + 1);
+
+    uint16_t none = static_cast<uint16_t>(cells);
+    parent[none] = none;
+    groupSize[none] = 0;
+    groupColor[none] = outsidePalette;
+
+    uint32_t palette = (1u << spec.colorCount) - 1;
+    uint32_t maxGroup = static_cast<uint32_t>(spec.maxGroup);
+
+    for (int row = 0; row < spec.rows; row++) {
+        for (int col = 0; col < spec.columns; col++) {
+            uint16_t cell = static_cast<uint16_t>(row * spec.columns + col);
+            parent[cell] = cell;
+
+            if (specialPercent > 0 && rng() % 100 < specialPercent) {
+                grid.cells[cell] = specials[rng() % static_cast<uint32_t>(specialKinds)];
+                groupSize[cell] = 0;
+                groupColor[cell] = outsidePalette;
+                continue;
+            }
+
+            uint16_t left = col > 0 ? findGroup(static_cast<uint16_t>(cell - 1)) : none;
+            uint16_t up = row > 0 ? findGroup(static_cast<uint16_t>(cell - spec.columns)) : none;
+            uint32_t leftColor = groupColor[left];
+            uint32_t upColor = groupColor[up];
+
+            // Two different groups of one colour merge through this cell.
+            bool shared = leftColor == upColor && left != up;
+            uint32_t joinLeft = 1u + groupSize[left] + (shared ? groupSize[up] : 0u);
+            uint32_t joinUp = 1u + groupSize[up] + (shared ? groupSize[left] : 0u);
+
+            uint32_t allowed = palette;
+            allowed &= ~(joinLeft > maxGroup ? 1u << leftColor : 0u);
+            allowed &= ~(joinUp > maxGroup ? 1u << upColor : 0u);
+
+            BallColor color = pickColor(allowed, rng);
+            grid.cells[cell] = color;
+            groupSize[cell] = 1;
+            groupColor[cell] = color;
+            if (leftColor == color) joinGroups(cell, left);
+            if (upColor == color) joinGroups(cell, up);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "SimCore.h"
+#include <cstdint>
+#include <vector>
+
+// What a generated board may contain. Same-coloured neighbours (left, right,
+// up, down) form groups; no group on a fresh board grows past maxGroup, so
+// with the default nothing matches before the first shot. Specials are
+// scattered at specialPercent and left out of the group bookkeeping.
+struct BoardSpec {
+    int rows = 10;
+    int columns = 14;
+    int colorCount = static_cast<int>(ballPalette.size());
+    int maxGroup = 3;
+    int specialPercent = 0;
+    bool allowBomb = false;
+    bool allowRainbow = false;
+    bool allowUniversal = false;
+};
+
+inline BallType ballTypeOf(BallColor color) {
+    if (color & colorUniversalFlag) return UNIVERSAL;
+    if (color & colorRainbowFlag) return RAINBOW;
+    if (color == colorBomb) return BOMB;
+    return NORMAL;
+}
+
+// Fills a colour grid row by row. Each cell's allowed colours start as the
+// first colorCount palette entries; the colours of the left and upper
+// groups are masked out when joining them would exceed maxGroup, and one
+// draw picks among what is left. Groups are tracked in a union-find over
+// the cells. At most two colours are ever masked, so with three or more
+// colours a cell always has a choice and nothing is retried. Scratch space
+// is kept between calls, so generating many boards does not allocate.
+class BoardGenerator {
+    std::vector<uint16_t> parent;
+    std::vector<uint8_t> groupSize;
+    std::vector<uint8_t> groupColor;
+
+    uint16_t findGroup(uint16_t cell);
+    void joinGroups(uint16_t a, uint16_t b);
+
+public:
+    static constexpr int maxCells = 4096;
+
+    // Returns false, leaving the grid untouched, if the spec cannot be met.
+    bool generate(const BoardSpec& spec, SimRng& rng, ColorGrid& grid);
+};
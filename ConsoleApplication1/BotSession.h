@@ -0,0 +1,42 @@
+#pragma once
+
+#include "BubbleSim.h"
+
+// Scripted player for headless runs: aims at a random point above the
+// launcher, holds the aim for a few ticks and fires. Level 0 plays endless
+// mode. Seeded, so the same seed replays the same session.
+class BotSession {
+    SimRng rng;
+    int level;
+    Vector2 target;
+    int aimTicks = 0;
+
+    void pickTarget() {
+        float dx = static_cast<float>(rng() % 201) - 100.0f;
+        float dy = -40.0f - static_cast<float>(rng() % 61);
+        target = { BubbleSim::newBallPosition.x + dx, BubbleSim::newBallPosition.y + dy };
+        aimTicks = 8 + static_cast<int>(rng() % 8);
+    }
+
+public:
+    BotSession(int sessionLevel, uint64_t seed) : rng(seed), level(sessionLevel) {
+        pickTarget();
+    }
+
+    InputState next(const BubbleSim& sim) {
+        InputState input{};
+        input.mousePosition = target;
+
+        if (sim.getGameState() != PLAYING) {
+            input.command = level > 0 ? COMMAND_START_LEVEL : COMMAND_START_ENDLESS;
+            input.commandLevel = level;
+            return input;
+        }
+
+        if (sim.isWaitingToShoot() && --aimTicks <= 0) {
+            input.mouseLeftPressed = true;
+            pickTarget();
+        }
+        return input;
+    }
+};
@@ -0,0 +1,1590 @@
+#include "BubbleSim.h"
+#include "ColorMatch.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+template <typename T>
+static void writeBytes(uint8_t*& cursor, const T& value) {
+    std::memcpy(cursor, &value, sizeof(T));
+    cursor += sizeof(T);
+}
+
+static bool writeFile(const char* path, const std::vector<uint8_t>& bytes) {
+    FILE* file = std::fopen(path, "wb");
+    if (!file) return false;
+
+    bool written = std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    std::fclose(file);
+    return written;
+}
+
+static bool readFile(const char* path, std::vector<uint8_t>& bytes) {
+    FILE* file = std::fopen(path, "rb");
+    if (!file) return false;
+
+    bytes.clear();
+    uint8_t buffer[4096];
+    size_t read;
+    while ((read = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        bytes.insert(bytes.end(), buffer, buffer + read);
+    }
+    std::fclose(file);
+    return true;
+}
+
+BubbleSim::BubbleSim(const SimConfig& simConfig) : currentBall(), isAiming(false), score(0),
+    gameState(MAIN_MENU), currentLevel(1), isLevelMode(false), config(simConfig),
+    input{}, frameDelta(0.0f), rainbowTimer(0.0f) {
+    rewind.configure(config.rewindBudgetBytes, config.rewindKeyframeInterval);
+    effectsRng.seed(std::random_device{}());
+    rng.seed(config.seed ? config.seed : (static_cast<uint64_t>(std::random_device{}()) << 32) | std::random_device{}());
+
+    balls.reserve(256);
+    particles.reserve(2048);
+    events.reserve(256);
+    rewindPacked.reserve(256);
+
+    createInitialBalls(false);
+    createNewBall();
+}
+
+BubbleSim::~BubbleSim() {
+    waitForBoardWorker();
+}
+
+void BubbleSim::createInitialBalls(bool isLevel) {
+    if (isLevel && (currentLevel < 1 || currentLevel > static_cast<int>(levelTable.size()))) {
+        currentLevel = 1;
+    }
+    applySpecialBallChances(isLevel);
+
+    boardSeed = rng();
+    buildBoard(isLevel ? currentLevel : 0, boardSeed, boardGenerator, balls);
+    occupancy.rebuild(balls);
+}
+
+// Lays out the starting board of `level` (0 for endless). It reads nothing
+// but its arguments, so the next level's board can be built on a worker
+// and still match what a build on the sim thread would give. Starting
+// boards hold plain colours only: a wild ball already on the board would
+// match on the first group check, and a placed bomb never goes off.
+void BubbleSim::buildBoard(int level, uint32_t seed, BoardGenerator& generator, BallList& out) {
+    TraceScope scope("buildBoard");
+    out.clear();
+
+    int ballsPerRow = static_cast<int>(gameAreaWidth / (ballRadius * 2.0f));
+    int rows = 10;
+    int ballLimit = std::numeric_limits<int>::max();
+    if (level > 0) {
+        ballLimit = levelTable[static_cast<size_t>(level) - 1].ballCount;
+        rows = ballLimit / ballsPerRow + 1;
+    }
+
+    std::array<std::byte, 512> gridBuffer;
+    std::pmr::monotonic_buffer_resource gridArena(gridBuffer.data(), gridBuffer.size());
+    ColorGrid colorGrid(rows, ballsPerRow, &gridArena);
+
+    BoardSpec spec;
+    spec.rows = rows;
+    spec.columns = ballsPerRow;
+    SimRng boardRng((static_cast<uint64_t>(seed) << 32) ^ (static_cast<uint64_t>(level) * 0x9E3779B97F4A7C15ull));
+    generator.generate(spec, boardRng, colorGrid);
+
+    float totalWidth = static_cast<float>(ballsPerRow) * ballRadius * 2.0f;
+    float startX = gameAreaLeft + (gameAreaWidth - totalWidth) / 2.0f + ballRadius;
+
+    int ballsCreated = 0;
+    for (int row = 0; row < rows && ballsCreated < ballLimit; row++) {
+        for (int col = 0; col < ballsPerRow && ballsCreated < ballLimit; col++) {
+            float x = startX + static_cast<float>(col) * (ballRadius * 2.0f);
+            float y = gameAreaTop + 10.0f + static_cast<float>(row) * (ballRadius * 2.0f);
+
+            if (x + ballRadius < gameAreaRight && y + ballRadius < gameAreaBottom) {
+                out.emplace_back(x, y, ballRadius, colorGrid.at(row, col), ballTypeOf(colorGrid.at(row, col)));
+                out.back().hasSupport = (row == 0);
+                ballsCreated++;
+            }
+        }
+    }
+}
+
+void BubbleSim::waitForBoardWorker() {
+    if (boardWorker.joinable()) {
+        boardWorker.join();
+    }
+}
+
+// Starts building the board of the level after the current one. Called at
+// the top of the tick after a level starts, so starting the worker never
+// lands on the transition tick itself. Sessions that reach the same level
+// with the same board seed (a rewind, a reload) keep the board that is
+// already there.
+void BubbleSim::startNextBoard() {
+    nextBoardWanted = false;
+    if (!isLevelMode || gameState != PLAYING || currentLevel >= static_cast<int>(levelTable.size())) return;
+
+    int level = currentLevel + 1;
+    if (nextBoard.level == level && nextBoard.seed == boardSeed) return;
+
+    waitForBoardWorker();
+    nextBoard.level = level;
+    nextBoard.seed = boardSeed;
+    boardWorker = std::thread([board = &nextBoard]() {
+        traceThreadName("board worker");
+        buildBoard(board->level, board->seed, board->generator, board->balls);
+        board->occupancy.rebuild(board->balls);
+    });
+}
+
+// Switches to the next level. The board normally comes finished from the
+// worker and is swapped in; if it was never started (or was built for
+// another seed) it is built here from the same inputs, with the same result.
+void BubbleSim::advanceLevel() {
+    TraceScope scope("advanceLevel");
+    currentLevel++;
+    waitForBoardWorker();
+    if (nextBoard.level != currentLevel || nextBoard.seed != boardSeed) {
+        buildBoard(currentLevel, boardSeed, nextBoard.generator, nextBoard.balls);
+        nextBoard.occupancy.rebuild(nextBoard.balls);
+    }
+
+    balls.swap(nextBoard.balls);
+    std::swap(occupancy, nextBoard.occupancy);
+    nextBoard.level = 0;
+
+    particles.clear();
+    currentBall.reset();
+    score = 0;
+    applySpecialBallChances(true);
+    createNewBall();
+    resetRewindHistory();
+    nextBoardWanted = true;
+}
+
+void BubbleSim::applySpecialBallChances(bool isLevel) {
+    if (isLevel && currentLevel >= 1 && currentLevel <= static_cast<int>(levelTable.size())) {
+        const Level& level = levelTable[static_cast<size_t>(currentLevel) - 1];
+        UNIVERSAL_CHANCE = level.allowUniversal ? 5 : 0;
+        BOMB_CHANCE = level.allowBomb ? 3 : 0;
+        RAINBOW_CHANCE = level.allowRainbow ? 2 : 0;
+    }
+    else {
+        UNIVERSAL_CHANCE = 5;
+        BOMB_CHANCE = 3;
+        RAINBOW_CHANCE = 2;
+    }
+}
+
+BallType BubbleSim::getRandomBallType() {
+    std::uniform_int_distribution<> chanceDist(0, 99);
+
+    int chance = chanceDist(rng);
+
+    if (chance < RAINBOW_CHANCE) {
+        return RAINBOW;
+    }
+    else if (chance < RAINBOW_CHANCE + BOMB_CHANCE) {
+        return BOMB;
+    }
+    else if (chance < RAINBOW_CHANCE + BOMB_CHANCE + UNIVERSAL_CHANCE) {
+        return UNIVERSAL;
+    }
+
+    return NORMAL;
+}
+
+BallColor BubbleSim::pickColor(uint32_t colorMask) {
+    int choices = 0;
+    for (uint32_t bits = colorMask; bits; bits &= bits - 1) {
+        choices++;
+    }
+
+    std::uniform_int_distribution<> choiceDist(0, choices - 1);
+    uint32_t bits = colorMask;
+    for (int skip = choiceDist(rng); skip > 0; skip--) {
+        bits &= bits - 1;
+    }
+    return static_cast<BallColor>(lowestSetBit(bits));
+}
+
+void BubbleSim::createNewBall() {
+    currentBall.reset();
+
+    // Projectiles only take colours still on the board, so the last few
+    // balls of a colour can always be cleared.
+    uint32_t present = 0;
+    const ColorCounts& counts = occupancy.getCounts();
+    for (size_t i = 0; i < counts.size(); i++) {
+        if (counts[i] > 0) present |= 1u << i;
+    }
+    if (present == 0) {
+        present = (1u << ballPalette.size()) - 1;
+    }
+
+    BallType ballType = getRandomBallType();
+    BallColor ballColor = pickColor(present);
+
+    currentBall.emplace(newBallPosition.x, newBallPosition.y, ballRadius,
+        ballColor, ballType);
+    currentBall->isStuck = false;
+    currentBall->originalPosition = newBallPosition;
+    currentBall->hasSupport = true;
+    isAiming = true;
+}
+
+void BubbleSim::tick(const InputState& tickInput, float dt) {
+    TraceScope scope("tick");
+    input = tickInput;
+    frameDelta = dt;
+
+    tickArena.reset();
+    events.clear();
+    dispatchedEvents = 0;
+
+    if (nextBoardWanted) {
+        startNextBoard();
+    }
+
+    applyCommand();
+    handleGlobalKeys();
+    update();
+    dispatchEvents();
+
+    if (gameState == PLAYING) {
+        simTick++;
+        maintainBallOrder();
+        recordRewindFrame();
+    }
+    traceCounters(static_cast<int>(balls.size()), static_cast<int>(particles.size()));
+}
+
+void BubbleSim::applyCommand() {
+    switch (input.command) {
+    case COMMAND_START_ENDLESS:
+        startEndless();
+        break;
+    case COMMAND_START_LEVEL:
+        startLevel(input.commandLevel);
+        break;
+    case COMMAND_OPEN_LEVEL_SELECT:
+        gameState = LEVEL_SELECT;
+        break;
+    case COMMAND_MAIN_MENU:
+        gameState = MAIN_MENU;
+        break;
+    default:
+        return;
+    }
+
+    // The click that pressed a menu button must not also fire the first shot.
+    input.mouseLeftPressed = false;
+}
+
+void BubbleSim::startEndless() {
+    isLevelMode = false;
+    gameState = PLAYING;
+    restart();
+}
+
+void BubbleSim::startLevel(int level) {
+    if (level < 1 || level > static_cast<int>(levelTable.size())) return;
+
+    isLevelMode = true;
+    currentLevel = level;
+    gameState = PLAYING;
+    restart();
+}
+
+void BubbleSim::recordRewindFrame() {
+    TraceScope scope("recordRewindFrame");
+    rewindPacked.clear();
+    for (const auto& ball : balls) {
+        rewindPacked.push_back(packBall(ball));
+    }
+
+    PackedBall projectile{};
+    if (currentBall) {
+        projectile = packBall(*currentBall);
+    }
+
+    rewind.record(simTick, makeSaveStateHeader(false), currentBall ? &projectile : nullptr,
+        rewindPacked.data(), rewindPacked.size());
+}
+
+void BubbleSim::resetRewindHistory() {
+    rewind.clear();
+    simTick = 0;
+    reorderPending = false;
+    shotHead = 0;
+    shotCount = 0;
+    if (gameState == PLAYING) {
+        recordRewindFrame();
+    }
+}
+
+uint32_t BubbleSim::lastShotTick() const {
+    return shotTicks[(shotHead + shotTicks.size() - 1) % shotTicks.size()];
+}
+
+bool BubbleSim::rewindTo(uint32_t targetTick) {
+    if (!rewind.reconstruct(targetTick, rewindState)) return false;
+    if (!loadState(rewindState.data(), rewindState.size())) return false;
+
+    rewind.truncateAfter(targetTick);
+    simTick = targetTick;
+    reorderPending = false;
+    while (shotCount > 0 && lastShotTick() >= targetTick) {
+        shotHead = (shotHead + shotTicks.size() - 1) % shotTicks.size();
+        shotCount--;
+    }
+    return true;
+}
+
+void BubbleSim::handleGlobalKeys() {
+    if (input.restartPressed) {
+        restart();
+    }
+
+    if (input.menuPressed) {
+        if (gameState == GAME_OVER || gameState == GAME_WON || gameState == PLAYING) {
+            gameState = MAIN_MENU;
+            restart();
+        }
+    }
+
+    if (input.escapePressed) {
+        if (gameState == PLAYING) {
+            gameState = MAIN_MENU;
+            restart();
+        }
+        else if (gameState == LEVEL_SELECT) {
+            gameState = MAIN_MENU;
+        }
+    }
+
+    if (input.saveStatePressed && gameState == PLAYING) {
+        saveState(checkpoint, true);
+        writeFile(quickSaveFile, checkpoint);
+    }
+
+    if (input.loadStatePressed) {
+        if (checkpoint.empty()) {
+            readFile(quickSaveFile, checkpoint);
+        }
+
+        if (!checkpoint.empty() && loadState(checkpoint.data(), checkpoint.size())) {
+            resetRewindHistory();
+        }
+    }
+
+    if (gameState == PLAYING && input.undoShotPressed && shotCount > 0) {
+        rewindTo(lastShotTick());
+    }
+
+    if (gameState == PLAYING && input.rewindPressed && !rewind.empty()) {
+        uint32_t span = static_cast<uint32_t>(3.0f * config.simulationRate);
+        uint32_t target = simTick > span ? simTick - span : 0;
+        if (target < rewind.oldestTick()) {
+            target = rewind.oldestTick();
+        }
+        rewindTo(target);
+    }
+}
+
+void BubbleSim::update() {
+    TraceScope scope("update");
+    updateParticles();
+
+    if (gameState == PLAYING) {
+        updateGame();
+    }
+}
+
+void BubbleSim::updateParticles() {
+    TraceScope scope("updateParticles");
+    for (size_t i = 0; i < particles.size(); ) {
+        Particle& p = particles[i];
+        p.position.x += p.velocity.x;
+        p.position.y += p.velocity.y;
+        p.life -= 0.02f;
+        p.size *= 0.98f;
+
+        if (p.life <= 0.0f) {
+            p = particles.back();
+            particles.pop_back();
+        }
+        else {
+            i++;
+        }
+    }
+}
+
+void BubbleSim::createExplosion(Vector2 position, Color color, int count) {
+    std::uniform_real_distribution<float> dist(-3.0f, 3.0f);
+    std::uniform_real_distribution<float> lifeDist(0.5f, 1.5f);
+    std::uniform_int_distribution<int> sizeDist(0, 4);
+
+    count = count * particlePercent.load(std::memory_order_relaxed) / 100;
+    for (int i = 0; i < count; i++) {
+        Particle p;
+        p.position = position;
+        p.velocity = { dist(effectsRng), dist(effectsRng) };
+        p.color = color;
+        p.size = 3.0f + static_cast<float>(sizeDist(effectsRng));
+        p.life = lifeDist(effectsRng);
+        particles.push_back(p);
+    }
+}
+
+void BubbleSim::emit(SimEventType type, const Ball& ball, int count, SimEventType source) {
+    events.push_back({ type, source, ball.type, ball.position, paletteColor(ball.color), count });
+}
+
+// Hands the events emitted since the last dispatch to the in-simulation
+// consumers as one batch. Runs mid-tick after collisions so the level check
+// sees the new score, and again at the end of the tick.
+void BubbleSim::dispatchEvents() {
+    TraceScope scope("dispatchEvents");
+    if (dispatchedEvents == events.size()) return;
+
+    const SimEvent* batch = events.data() + dispatchedEvents;
+    size_t count = events.size() - dispatchedEvents;
+    dispatchedEvents = events.size();
+
+    applyScoring(batch, count);
+    if (config.effects) {
+        spawnEffects(batch, count);
+    }
+}
+
+void BubbleSim::applyScoring(const SimEvent* batch, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        const SimEvent& event = batch[i];
+
+        if (event.type == EVENT_MATCH) {
+            score += event.count * 15;
+
+            if (event.count >= 5) score += event.count * 10;
+            if (event.count >= 7) score += event.count * 20;
+            if (event.count >= 10) score += event.count * 30;
+
+            if (event.count == 4) {
+                score += 25;
+            }
+
+            score += traitsOf(event.ballType).matchBonus;
+        }
+        else if (event.type == EVENT_BOMB) {
+            score += event.count * 20;
+        }
+        else if (event.type == EVENT_RAINBOW) {
+            score += event.count * 25;
+        }
+    }
+}
+
+// Big cascades share a fixed particle budget instead of bursting per ball.
+void BubbleSim::spawnEffects(const SimEvent* batch, size_t count) {
+    const int popParticleBudget = 160;
+
+    int pops = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (batch[i].type == EVENT_POP) pops++;
+    }
+    int popShare = pops > 0 ? std::max(1, popParticleBudget / pops) : 0;
+
+    for (size_t i = 0; i < count; i++) {
+        const SimEvent& event = batch[i];
+
+        if (event.type == EVENT_BOMB) {
+            createExplosion(event.position, YELLOW, 50);
+        }
+        else if (event.type == EVENT_RAINBOW) {
+            createExplosion(event.position, event.color, 40);
+        }
+        else if (event.type == EVENT_POP) {
+            if (event.source == EVENT_BOMB) {
+                createExplosion(event.position, RED, std::min(10, popShare));
+            }
+            else {
+                createExplosion(event.position, event.color, std::min(5, popShare));
+            }
+        }
+    }
+}
+
+void BubbleSim::updateGame() {
+    updateRainbowBalls();
+
+    if (isAiming) {
+        handleAiming();
+        updateBallPhysics();
+    }
+    else {
+        updatePhysics();
+        checkCollisions();
+        dispatchEvents();
+        updateBallPhysics();
+        checkSupport();
+        applyClusterMagnetForces();
+        applyAntiGravity();
+        checkGameOver();
+        if (isLevelMode) {
+            checkLevelComplete();
+        }
+    }
+}
+
+// Rainbow balls step through red, orange, yellow, green, sky blue, blue and
+// purple; colours outside that cycle restart it at red.
+void BubbleSim::updateRainbowBalls() {
+    static constexpr std::array<BallColor, ballPalette.size()> rainbowNext = {
+        5, 4, 7, 2, 0, 3, 0, 1, 0, 0
+    };
+
+    rainbowTimer += frameDelta;
+
+    if (rainbowTimer > 0.1f) {
+        rainbowTimer = 0.0f;
+
+        for (size_t i = 0; i < balls.size(); i++) {
+            Ball& ball = balls[i];
+            if (traitsOf(ball.type).cyclesColor && ball.active) {
+                BallColor next = static_cast<BallColor>(colorRainbowFlag | rainbowNext[ball.color & colorIndexMask]);
+                occupancy.recolor(i, ball.color, next);
+                ball.color = next;
+            }
+        }
+    }
+}
+
+Vector2 BubbleSim::aimTarget(Vector2 mousePosition) {
+    Vector2 targetPosition = mousePosition;
+
+    float maxAimDistance = 100.0f;
+    float dx = targetPosition.x - newBallPosition.x;
+    float dy = targetPosition.y - newBallPosition.y;
+    float distance = sqrtf(dx * dx + dy * dy);
+
+    if (distance > maxAimDistance) {
+        targetPosition.x = newBallPosition.x + (dx / distance) * maxAimDistance;
+        targetPosition.y = newBallPosition.y + (dy / distance) * maxAimDistance;
+    }
+
+    if (targetPosition.x - ballRadius < gameAreaLeft) {
+        targetPosition.x = gameAreaLeft + ballRadius;
+    }
+    else if (targetPosition.x + ballRadius > gameAreaRight) {
+        targetPosition.x = gameAreaRight - ballRadius;
+    }
+
+    if (targetPosition.y - ballRadius < gameAreaTop) {
+        targetPosition.y = gameAreaTop + ballRadius;
+    }
+    else if (targetPosition.y + ballRadius > gameAreaBottom) {
+        targetPosition.y = gameAreaBottom - ballRadius;
+    }
+
+    if (targetPosition.y > newBallPosition.y) {
+        targetPosition.y = newBallPosition.y;
+    }
+    return targetPosition;
+}
+
+Vector2 BubbleSim::aimDirectionFrom(Vector2 ballPosition) {
+    Vector2 direction = {
+        ballPosition.x - newBallPosition.x,
+        ballPosition.y - newBallPosition.y
+    };
+
+    float length = sqrtf(direction.x * direction.x + direction.y * direction.y);
+    if (length > 0.0f) {
+        direction.x /= length;
+        direction.y /= length;
+    }
+    return direction;
+}
+
+void BubbleSim::handleAiming() {
+    if (!currentBall) return;
+
+    Vector2 targetPosition = aimTarget(input.mousePosition);
+    currentBall->position.x += (targetPosition.x - currentBall->position.x) * aimSmoothing;
+    currentBall->position.y += (targetPosition.y - currentBall->position.y) * aimSmoothing;
+    aimDirection = aimDirectionFrom(currentBall->position);
+
+    if (input.mouseLeftPressed) {
+        shootBall();
+    }
+}
+
+void BubbleSim::shootBall() {
+    if (!currentBall) return;
+
+    float dx = currentBall->position.x - newBallPosition.x;
+    float dy = currentBall->position.y - newBallPosition.y;
+    float distance = sqrtf(dx * dx + dy * dy);
+    float power = distance / 50.0f;
+
+    if (power > 1.5f) power = 1.5f;
+    if (power < 0.3f) power = 0.3f;
+
+    currentBall->velocity = {
+        aimDirection.x * shootSpeed * power,
+        aimDirection.y * shootSpeed * power
+    };
+    currentBall->isStuck = false;
+    currentBall->hasSupport = false;
+    isAiming = false;
+    emit(EVENT_SHOT, *currentBall);
+
+    shotTicks[shotHead] = simTick;
+    shotHead = (shotHead + 1) % shotTicks.size();
+    shotCount = std::min(shotCount + 1, shotTicks.size());
+}
+
+void BubbleSim::updatePhysics() {
+    TraceScope scope("updatePhysics");
+    if (currentBall && !currentBall->isStuck) {
+        float currentSpeed = sqrtf(currentBall->velocity.x * currentBall->velocity.x +
+            currentBall->velocity.y * currentBall->velocity.y);
+        if (currentSpeed < 8.0f) {
+            applyMagnetForces(*currentBall);
+        }
+
+        currentBall->position.x += currentBall->velocity.x;
+        currentBall->position.y += currentBall->velocity.y;
+
+        if (currentBall->position.x - currentBall->radius < gameAreaLeft) {
+            currentBall->position.x = gameAreaLeft + currentBall->radius;
+            currentBall->velocity.x *= -0.7f;
+        }
+        else if (currentBall->position.x + currentBall->radius > gameAreaRight) {
+            currentBall->position.x = gameAreaRight - currentBall->radius;
+            currentBall->velocity.x *= -0.7f;
+        }
+
+        if (currentBall->position.y - currentBall->radius < gameAreaTop) {
+            currentBall->position.y = gameAreaTop + currentBall->radius;
+            currentBall->velocity.y *= -0.7f;
+        }
+
+        if (currentBall->position.y + currentBall->radius > gameAreaBottom) {
+            currentBall->position.y = gameAreaBottom - currentBall->radius;
+            currentBall->velocity.y *= -0.7f;
+        }
+
+        currentBall->velocity.x *= 0.99f;
+        currentBall->velocity.y *= 0.99f;
+
+        if (fabsf(currentBall->velocity.x) < minVelocity) currentBall->velocity.x = 0.0f;
+        if (fabsf(currentBall->velocity.y) < minVelocity) currentBall->velocity.y = 0.0f;
+    }
+}
+
+void BubbleSim::applyMagnetForces(Ball& movingBall) {
+    for (auto& ball : balls) {
+        if (!ball.active || !ball.isStuck) continue;
+
+        float dx = ball.position.x - movingBall.position.x;
+        float dy = ball.position.y - movingBall.position.y;
+        float distance = sqrtf(dx * dx + dy * dy);
+
+        if (distance < maxMagnetDistance && distance > ballRadius * 2.5f) {
+            float force = magnetStrength * (1.0f - distance / maxMagnetDistance);
+            force *= 0.3f;
+
+            float forceX = (dx / distance) * force;
+            float forceY = (dy / distance) * force;
+
+            movingBall.velocity.x += forceX;
+            movingBall.velocity.y += forceY;
+        }
+    }
+}
+
+void BubbleSim::applyClusterMagnetForces() {
+    TraceScope scope("applyClusterMagnetForces");
+    Vector2 clusterCenter = { 0.0f, 0.0f };
+    int clusterCount = 0;
+
+    for (auto& ball : balls) {
+        if (!ball.active || !ball.isStuck || !ball.hasSupport) continue;
+
+        clusterCenter.x += ball.position.x;
+        clusterCenter.y += ball.position.y;
+        clusterCount++;
+    }
+
+    if (clusterCount == 0) {
+        clusterCenter = { screenWidth / 2.0f, gameAreaBottom - 100.0f };
+        clusterCount = 1;
+    }
+    else {
+        clusterCenter.x /= clusterCount;
+        clusterCenter.y /= clusterCount;
+    }
+
+    for (auto& ball : balls) {
+        if (!ball.active || !ball.isStuck || ball.hasSupport) continue;
+
+        float dx = clusterCenter.x - ball.position.x;
+        float dy = clusterCenter.y - ball.position.y;
+        float distance = sqrtf(dx * dx + dy * dy);
+
+        if (distance > ballRadius * 2.0f) {
+            float force = clusterMagnetStrength * (0.5f + distance / 100.0f);
+
+            if (distance > 100.0f) force *= 2.0f;
+
+            float forceX = (dx / distance) * force;
+            float forceY = (dy / distance) * force;
+
+            ball.velocity.x += forceX;
+            ball.velocity.y += forceY;
+
+            float speed = sqrtf(ball.velocity.x * ball.velocity.x + ball.velocity.y * ball.velocity.y);
+            if (speed > maxBallSpeed * 3.0f) {
+                ball.velocity.x = (ball.velocity.x / speed) * maxBallSpeed * 3.0f;
+                ball.velocity.y = (ball.velocity.y / speed) * maxBallSpeed * 3.0f;
+            }
+        }
+    }
+
+    if (currentBall && !currentBall->isStuck) {
+        float currentSpeed = sqrtf(currentBall->velocity.x * currentBall->velocity.x +
+            currentBall->velocity.y * currentBall->velocity.y);
+        if (currentSpeed < 10.0f) {
+            float dx = clusterCenter.x - currentBall->position.x;
+            float dy = clusterCenter.y - currentBall->position.y;
+            float distance = sqrtf(dx * dx + dy * dy);
+
+            if (distance > ballRadius * 3.0f) {
+                float force = clusterMagnetStrength * 0.7f * (0.5f + distance / 100.0f);
+
+                float forceX = (dx / distance) * force;
+                float forceY = (dy / distance) * force;
+
+                currentBall->velocity.x += forceX;
+                currentBall->velocity.y += forceY;
+            }
+        }
+    }
+}
+
+void BubbleSim::checkSupport() {
+    TraceScope scope("checkSupport");
+    for (auto& ball : balls) {
+        if (!ball.active || !ball.isStuck) continue;
+        ball.hasSupport = false;
+    }
+
+    for (auto& ball : balls) {
+        if (!ball.active || !ball.isStuck) continue;
+        if (ball.position.y - ball.radius <= gameAreaTop + 1.0f) {
+            ball.hasSupport = true;
+        }
+    }
+
+    bool changed;
+    int maxIterations = 1000;
+    int iterations = 0;
+
+    do {
+        changed = false;
+        iterations++;
+
+        for (auto& ball : balls) {
+            if (!ball.active || !ball.isStuck || ball.hasSupport) continue;
+
+            for (const auto& other : balls) {
+                if (!other.active || !other.isStuck || !other.hasSupport) continue;
+
+                float dx = other.position.x - ball.position.x;
+                float dy = other.position.y - ball.position.y;
+                float distance = sqrtf(dx * dx + dy * dy);
+
+                if (distance < ballRadius * 2.2f) {
+                    ball.hasSupport = true;
+                    changed = true;
+                    break;
+                }
+            }
+        }
+
+        if (iterations >= maxIterations) {
+            break;
+        }
+    } while (changed);
+}
+
+void BubbleSim::applyAntiGravity() {
+    TraceScope scope("applyAntiGravity");
+    for (auto& ball : balls) {
+        if (!ball.active || !ball.isStuck || ball.hasSupport) continue;
+
+        ball.velocity.y += antiGravity * 0.3f;
+
+        if (ball.velocity.y < -1.5f) {
+            ball.velocity.y = -1.5f;
+        }
+    }
+}
+
+void BubbleSim::updateBallPhysics() {
+    TraceScope scope("updateBallPhysics");
+    if (config.solver == SOLVER_PBD) {
+        solveClusterConstraints();
+        return;
+    }
+
+    resolveOverlaps();
+    updateConnections();
+    applyDampingAndLimits();
+}
+
+void BubbleSim::resolveOverlaps() {
+    TraceScope scope("resolveOverlaps");
+    for (size_t i = 0; i < balls.size(); i++) {
+        if (!balls[i].active || !balls[i].isStuck) continue;
+
+        for (size_t j = i + 1; j < balls.size(); j++) {
+            if (!balls[j].active || !balls[j].isStuck) continue;
+
+            float dx = balls[j].position.x - balls[i].position.x;
+            float dy = balls[j].position.y - balls[i].position.y;
+            float distance = sqrtf(dx * dx + dy * dy);
+            float minDistance = balls[i].radius + balls[j].radius;
+
+            if (distance < minDistance && distance > 0.1f) {
+                float overlap = (minDistance - distance) * 0.5f;
+                float moveX = (dx / distance) * overlap * separationForce;
+                float moveY = (dy / distance) * overlap * separationForce;
+
+                balls[i].position.x -= moveX;
+                balls[i].position.y -= moveY;
+                balls[j].position.x += moveX;
+                balls[j].position.y += moveY;
+            }
+        }
+    }
+}
+
+void BubbleSim::updateConnections() {
+    TraceScope scope("updateConnections");
+    for (size_t i = 0; i < balls.size(); i++) {
+        if (!balls[i].active || !balls[i].isStuck) continue;
+
+        Vector2 totalForce = { 0.0f, 0.0f };
+        int connectionCount = 0;
+
+        for (size_t j = 0; j < balls.size(); j++) {
+            if (i == j || !balls[j].active || !balls[j].isStuck) continue;
+
+            float dx = balls[j].position.x - balls[i].position.x;
+            float dy = balls[j].position.y - balls[i].position.y;
+            float distance = sqrtf(dx * dx + dy * dy);
+
+            if (distance < ballRadius * 2.8f) {
+                float targetDistance = ballRadius * 2.0f;
+                float displacement = distance - targetDistance;
+
+                if (fabsf(displacement) > 0.5f) {
+                    float force = displacement * balls[i].stiffness;
+                    if (distance > ballRadius * 2.2f) {
+                        force *= 0.3f;
+                    }
+
+                    totalForce.x += (dx / distance) * force;
+                    totalForce.y += (dy / distance) * force;
+                    connectionCount++;
+                }
+            }
+        }
+
+        float restoreForce = 0.01f;
+        totalForce.x += (balls[i].originalPosition.x - balls[i].position.x) * restoreForce;
+        totalForce.y += (balls[i].originalPosition.y - balls[i].position.y) * restoreForce;
+
+        if (connectionCount > 0 || restoreForce > 0.0f) {
+            balls[i].velocity.x += totalForce.x;
+            balls[i].velocity.y += totalForce.y;
+        }
+    }
+}
+
+void BubbleSim::applyDampingAndLimits() {
+    TraceScope scope("applyDampingAndLimits");
+    for (auto& ball : balls) {
+        if (!ball.active || !ball.isStuck) continue;
+
+        ball.velocity.x *= ball.damping;
+        ball.velocity.y *= ball.damping;
+
+        float speed = sqrtf(ball.velocity.x * ball.velocity.x + ball.velocity.y * ball.velocity.y);
+        if (speed > maxBallSpeed) {
+            ball.velocity.x = (ball.velocity.x / speed) * maxBallSpeed;
+            ball.velocity.y = (ball.velocity.y / speed) * maxBallSpeed;
+        }
+
+        if (fabsf(ball.velocity.x) < 0.05f) ball.velocity.x = 0.0f;
+        if (fabsf(ball.velocity.y) < 0.05f) ball.velocity.y = 0.0f;
+
+        ball.position.x += ball.velocity.x;
+        ball.position.y += ball.velocity.y;
+
+        clampToGameArea(ball);
+    }
+}
+
+void BubbleSim::clampToGameArea(Ball& ball) {
+    const float margin = 5.0f;
+    if (ball.position.x - ball.radius < gameAreaLeft + margin) {
+        ball.position.x = gameAreaLeft + ball.radius + margin;
+        ball.velocity.x = 0.0f;
+    }
+    else if (ball.position.x + ballRadius > gameAreaRight - margin) {
+        ball.position.x = gameAreaRight - ball.radius - margin;
+        ball.velocity.x = 0.0f;
+    }
+
+    if (ball.position.y - ball.radius < gameAreaTop) {
+        ball.position.y = gameAreaTop + ball.radius;
+        ball.velocity.y = 0.0f;
+        ball.hasSupport = true;
+    }
+
+    if (ball.position.y + ball.radius > gameAreaBottom) {
+        ball.position.y = gameAreaBottom - ball.radius;
+        ball.velocity.y = 0.0f;
+    }
+}
+
+// Position-based alternative to the springs: positions are predicted from
+// the damped velocity, then overlap, bond and wall constraints are projected
+// solverIterations times and the velocity is taken from the net motion.
+// Neighbour pairs are gathered once per tick; pairs that start closer than
+// pbdBondRange are bonded and pulled back to touching. A ball that moves
+// less than pbdSleepDistance in a tick keeps its previous position, so a
+// settled board stops moving instead of jittering.
+void BubbleSim::solveClusterConstraints() {
+    TraceScope scope("solveClusterConstraints");
+    struct Pair {
+        uint16_t a;
+        uint16_t b;
+        bool bonded;
+    };
+
+    std::pmr::vector<Vector2> previous(balls.size(), Vector2{ 0.0f, 0.0f }, &tickArena);
+    std::pmr::vector<Pair> pairs(&tickArena);
+
+    for (size_t i = 0; i < balls.size(); i++) {
+        Ball& ball = balls[i];
+        if (!ball.active || !ball.isStuck) continue;
+
+        previous[i] = ball.position;
+        ball.velocity.x *= ball.damping;
+        ball.velocity.y *= ball.damping;
+
+        float speed = sqrtf(ball.velocity.x * ball.velocity.x + ball.velocity.y * ball.velocity.y);
+        if (speed > maxBallSpeed) {
+            ball.velocity.x = (ball.velocity.x / speed) * maxBallSpeed;
+            ball.velocity.y = (ball.velocity.y / speed) * maxBallSpeed;
+        }
+
+        ball.position.x += ball.velocity.x;
+        ball.position.y += ball.velocity.y;
+        ball.position.x += (ball.originalPosition.x - ball.position.x) * pbdAnchorStiffness;
+        ball.position.y += (ball.originalPosition.y - ball.position.y) * pbdAnchorStiffness;
+    }
+
+    const float neighbourRange = ballRadius * pbdNeighbourRange;
+    const float bondRange = ballRadius * pbdBondRange;
+    for (size_t i = 0; i < balls.size(); i++) {
+        if (!balls[i].active || !balls[i].isStuck) continue;
+
+        for (size_t j = i + 1; j < balls.size(); j++) {
+            if (!balls[j].active || !balls[j].isStuck) continue;
+
+            float dx = balls[j].position.x - balls[i].position.x;
+            float dy = balls[j].position.y - balls[i].position.y;
+            float distanceSquared = dx * dx + dy * dy;
+            if (distanceSquared < neighbourRange * neighbourRange) {
+                pairs.push_back({ static_cast<uint16_t>(i), static_cast<uint16_t>(j),
+                    distanceSquared < bondRange * bondRange });
+            }
+        }
+    }
+
+    for (int iteration = 0; iteration < config.solverIterations; iteration++) {
+        for (const Pair& pair : pairs) {
+            Ball& a = balls[pair.a];
+            Ball& b = balls[pair.b];
+
+            float dx = b.position.x - a.position.x;
+            float dy = b.position.y - a.position.y;
+            float distance = sqrtf(dx * dx + dy * dy);
+            if (distance < 0.1f) continue;
+
+            float target = a.radius + b.radius;
+            float correction;
+            if (distance < target) {
+                correction = (target - distance) * 0.5f;
+            }
+            else if (pair.bonded) {
+                correction = (target - distance) * 0.5f * pbdBondStiffness;
+            }
+            else {
+                continue;
+            }
+
+            float moveX = (dx / distance) * correction;
+            float moveY = (dy / distance) * correction;
+            a.position.x -= moveX;
+            a.position.y -= moveY;
+            b.position.x += moveX;
+            b.position.y += moveY;
+        }
+
+        for (Ball& ball : balls) {
+            if (ball.active && ball.isStuck) {
+                clampToGameArea(ball);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < balls.size(); i++) {
+        Ball& ball = balls[i];
+        if (!ball.active || !ball.isStuck) continue;
+
+        float moveX = ball.position.x - previous[i].x;
+        float moveY = ball.position.y - previous[i].y;
+        if (moveX * moveX + moveY * moveY < pbdSleepDistance * pbdSleepDistance) {
+            ball.position = previous[i];
+            ball.velocity = { 0.0f, 0.0f };
+        }
+        else {
+            ball.velocity = { moveX, moveY };
+        }
+    }
+}
+
+void BubbleSim::checkCollisions() {
+    TraceScope scope("checkCollisions");
+    if (!currentBall || currentBall->isStuck) return;
+
+    bool hasCollision = false;
+    Ball* closestBall = nullptr;
+    float minDistance = std::numeric_limits<float>::max();
+
+    for (auto& ball : balls) {
+        if (!ball.active || !ball.isStuck) continue;
+
+        float dx = currentBall->position.x - ball.position.x;
+        float dy = currentBall->position.y - ball.position.y;
+        float distance = sqrtf(dx * dx + dy * dy);
+
+        if (distance < currentBall->radius + ball.radius) {
+            if (distance < minDistance) {
+                minDistance = distance;
+                hasCollision = true;
+                closestBall = &ball;
+            }
+        }
+    }
+
+    if (hasCollision && closestBall) {
+        currentBall->isStuck = true;
+        currentBall->hasSupport = closestBall->hasSupport;
+
+        float impactTransfer = 0.1f;
+        closestBall->velocity.x += currentBall->velocity.x * impactTransfer;
+        closestBall->velocity.y += currentBall->velocity.y * impactTransfer;
+
+        float dx = currentBall->position.x - closestBall->position.x;
+        float dy = currentBall->position.y - closestBall->position.y;
+        float distance = sqrtf(dx * dx + dy * dy);
+        float targetDistance = currentBall->radius + closestBall->radius;
+
+        if (distance > 0.0f) {
+            currentBall->position.x = closestBall->position.x + (dx / distance) * targetDistance;
+            currentBall->position.y = closestBall->position.y + (dy / distance) * targetDistance;
+            currentBall->originalPosition = currentBall->position;
+        }
+
+        emit(EVENT_ATTACH, *currentBall);
+
+        if (traitsOf(currentBall->type).explodesOnAttach) {
+            activateBomb(*currentBall);
+            currentBall.reset();
+            createNewBall();
+            return;
+        }
+
+        balls.push_back(*currentBall);
+        occupancy.add(balls.size() - 1, balls.back().color);
+        currentBall.reset();
+
+        checkBallGroups();
+
+        createNewBall();
+    }
+
+    if (currentBall && !currentBall->isStuck) {
+        if (currentBall->position.y > gameAreaBottom + 50.0f ||
+            currentBall->position.y < gameAreaTop - 50.0f ||
+            currentBall->position.x < gameAreaLeft - 50.0f ||
+            currentBall->position.x > gameAreaRight + 50.0f) {
+
+            emit(EVENT_DROP, *currentBall);
+            currentBall.reset();
+            createNewBall();
+        }
+    }
+}
+
+void BubbleSim::compactBalls() {
+    size_t before = balls.size();
+    balls.erase(std::remove_if(balls.begin(), balls.end(),
+        [](const Ball& ball) { return !ball.active; }),
+        balls.end());
+    occupancy.rebuild(balls);
+
+    if (before - balls.size() >= reorderAfterRemoved) {
+        reorderPending = true;
+    }
+}
+
+static uint32_t spreadBits(uint32_t value) {
+    value &= 0xFFFF;
+    value = (value | (value << 8)) & 0x00FF00FF;
+    value = (value | (value << 4)) & 0x0F0F0F0F;
+    value = (value | (value << 2)) & 0x33333333;
+    value = (value | (value << 1)) & 0x55555555;
+    return value;
+}
+
+void BubbleSim::maintainBallOrder() {
+    // Keyed off simTick so a replay or a rewound run reorders on the same ticks.
+    if (config.reorderInterval > 0 && simTick % config.reorderInterval == 0) {
+        reorderPending = true;
+    }
+    if (!reorderPending) return;
+
+    reorderBalls();
+    reorderPending = false;
+}
+
+// Sorts the balls by the Z-order key of their cell on a ball-radius grid,
+// so balls that touch mostly sit next to each other in memory. Ball indices
+// change, so everything keyed by index is rebuilt and the rewind history
+// starts a new keyframe rather than diffing against the old order.
+void BubbleSim::reorderBalls() {
+    TraceScope scope("reorderBalls");
+    std::pmr::vector<std::pair<uint32_t, uint32_t>> order(&tickArena);
+    order.reserve(balls.size());
+
+    for (size_t i = 0; i < balls.size(); i++) {
+        float cellX = std::max(0.0f, (balls[i].position.x - gameAreaLeft) / ballRadius);
+        float cellY = std::max(0.0f, (balls[i].position.y - gameAreaTop) / ballRadius);
+        uint32_t key = spreadBits(static_cast<uint32_t>(cellX)) | (spreadBits(static_cast<uint32_t>(cellY)) << 1);
+        order.push_back({ key, static_cast<uint32_t>(i) });
+    }
+    std::sort(order.begin(), order.end());
+
+    reorderScratch.clear();
+    for (const auto& entry : order) {
+        reorderScratch.push_back(balls[entry.second]);
+    }
+    balls.swap(reorderScratch);
+
+    occupancy.rebuild(balls);
+    rewind.requestKeyframe();
+}
+
+void BubbleSim::activateBomb(Ball& bomb) {
+    std::pmr::vector<size_t> toRemove(&tickArena);
+    for (size_t i = 0; i < balls.size(); i++) {
+        if (!balls[i].active) continue;
+
+        float dx = balls[i].position.x - bomb.position.x;
+        float dy = balls[i].position.y - bomb.position.y;
+        float distance = sqrtf(dx * dx + dy * dy);
+
+        if (distance < bomb.bombRadius) {
+            toRemove.push_back(i);
+        }
+    }
+
+    emit(EVENT_BOMB, bomb, static_cast<int>(toRemove.size()));
+    for (size_t index : toRemove) {
+        balls[index].active = false;
+        emit(EVENT_POP, balls[index], 1, EVENT_BOMB);
+    }
+
+    compactBalls();
+    applyGentleRemovalImpulse();
+}
+
+void BubbleSim::activateRainbow(Ball& rainbowBall) {
+    std::pmr::vector<size_t> toRemove(&tickArena);
+    occupancy.forEach(rainbowBall.color & colorIndexMask, [&](size_t index) { toRemove.push_back(index); });
+
+    emit(EVENT_RAINBOW, rainbowBall, static_cast<int>(toRemove.size()));
+    for (size_t index : toRemove) {
+        balls[index].active = false;
+        emit(EVENT_POP, balls[index], 1, EVENT_RAINBOW);
+    }
+
+    for (size_t i = 0; i < balls.size(); i++) {
+        if (&balls[i] == &rainbowBall) {
+            balls[i].active = false;
+            break;
+        }
+    }
+
+    compactBalls();
+    applyGentleRemovalImpulse();
+}
+
+void BubbleSim::checkBallGroups() {
+    TraceScope scope("checkBallGroups");
+    if (balls.empty()) return;
+
+    std::pmr::vector<int> toRemove(&tickArena);
+    std::pmr::vector<bool> visited(balls.size(), false, &tickArena);
+    std::pmr::vector<int> group(&tickArena);
+
+    std::pmr::vector<uint8_t> keys(paddedColorCount(balls.size()), colorIgnore, &tickArena);
+    for (size_t i = 0; i < balls.size(); i++) {
+        if (balls[i].active && balls[i].isStuck) {
+            keys[i] = balls[i].color;
+        }
+    }
+
+    for (size_t i = 0; i < balls.size(); i++) {
+        if (!balls[i].active || visited[i] || !balls[i].isStuck) continue;
+
+        group.clear();
+        findConnectedBalls(static_cast<int>(i), group, keys, visited);
+
+        const BallTypeTraits& traits = traitsOf(balls[i].type);
+        if (group.size() >= 4 || traits.matchesAlone) {
+            if (traits.activatesOnMatch && group.size() >= 4) {
+                activateRainbow(balls[static_cast<size_t>(group[0])]);
+                return;
+            }
+
+            toRemove.insert(toRemove.end(), group.begin(), group.end());
+            emit(EVENT_MATCH, balls[i], static_cast<int>(group.size()));
+        }
+    }
+
+    for (int index : toRemove) {
+        balls[static_cast<size_t>(index)].active = false;
+        emit(EVENT_POP, balls[static_cast<size_t>(index)], 1, EVENT_MATCH);
+    }
+
+    if (!toRemove.empty()) {
+        compactBalls();
+        applyGentleRemovalImpulse();
+    }
+}
+
+void BubbleSim::applyGentleRemovalImpulse() {
+    std::uniform_int_distribution<int> impulseDist(-5, 5);
+
+    for (auto& ball : balls) {
+        if (ball.isStuck) {
+            int randomX = impulseDist(rng);
+            int randomY = impulseDist(rng);
+            ball.velocity.x += static_cast<float>(randomX) / 100.0f;
+            ball.velocity.y += static_cast<float>(randomY) / 100.0f;
+        }
+    }
+}
+
+// `keys` holds the colour of every stuck, active ball and colorIgnore for the
+// rest; visited balls are masked out as the search reaches them. The group
+// takes its colour from the ball it started at, so a wild start matches
+// every neighbour and a plain start matches its own colour plus wild balls.
+void BubbleSim::findConnectedBalls(int startIndex, std::pmr::vector<int>& group, std::pmr::vector<uint8_t>& keys,
+    std::pmr::vector<bool>& visited) {
+    if (visited[static_cast<size_t>(startIndex)]) return;
+
+    visited[static_cast<size_t>(startIndex)] = true;
+    group.push_back(startIndex);
+
+    const Ball& origin = balls[static_cast<size_t>(group.front())];
+    BallColor target = origin.color;
+    bool matchesAny = (target & colorWildMask) != 0;
+    keys[static_cast<size_t>(startIndex)] = colorIgnore;
+
+    Vector2 center = balls[static_cast<size_t>(startIndex)].position;
+
+    for (size_t base = 0; base < keys.size(); base += colorBatch) {
+        uint32_t bits = matchesAny ? matchAnyColor(keys.data() + base) : matchColorOrWild(keys.data() + base, target);
+
+        while (bits) {
+            size_t i = base + static_cast<size_t>(lowestSetBit(bits));
+            bits &= bits - 1;
+            if (visited[i]) continue;
+
+            float dx = balls[i].position.x - center.x;
+            float dy = balls[i].position.y - center.y;
+            float distance = sqrtf(dx * dx + dy * dy);
+
+            if (distance < ballRadius * 2.2f) {
+                findConnectedBalls(static_cast<int>(i), group, keys, visited);
+            }
+        }
+    }
+}
+
+void BubbleSim::checkGameOver() {
+    if (balls.size() > 175) {
+        gameState = GAME_OVER;
+        events.push_back({ EVENT_GAME_OVER, EVENT_GAME_OVER, NORMAL, newBallPosition, WHITE, static_cast<int>(balls.size()) });
+    }
+}
+
+void BubbleSim::checkLevelComplete() {
+    if (currentLevel < 1 || currentLevel > static_cast<int>(levelTable.size())) {
+        return;
+    }
+
+    const Level& level = levelTable[static_cast<size_t>(currentLevel) - 1];
+
+    if (score >= level.targetScore) {
+        events.push_back({ EVENT_LEVEL_COMPLETE, EVENT_LEVEL_COMPLETE, NORMAL, newBallPosition, WHITE, currentLevel });
+
+        if (currentLevel < static_cast<int>(levelTable.size())) {
+            gameState = PLAYING;
+            advanceLevel();
+        }
+        else {
+            gameState = GAME_WON;
+            events.push_back({ EVENT_GAME_WON, EVENT_GAME_WON, NORMAL, newBallPosition, WHITE, currentLevel });
+        }
+    }
+}
+
+void BubbleSim::fillSnapshot(RenderSnapshot& snapshot) const {
+    snapshot.balls.clear();
+    for (const auto& ball : balls) {
+        if (ball.active) {
+            snapshot.balls.push_back(makeBallView(ball));
+        }
+    }
+
+    snapshot.particles.assign(particles.begin(), particles.end());
+
+    snapshot.hasCurrentBall = currentBall.has_value();
+    if (currentBall) {
+        snapshot.currentBall = makeBallView(*currentBall);
+    }
+    snapshot.isAiming = isAiming;
+    snapshot.aimDirection = aimDirection;
+    snapshot.score = score;
+    snapshot.gameState = gameState;
+    snapshot.currentLevel = currentLevel;
+    snapshot.isLevelMode = isLevelMode;
+    snapshot.rewindBytes = rewind.memoryUsed();
+    snapshot.colorCounts = occupancy.getCounts();
+    snapshot.inputSerial = input.serial;
+}
+
+BallView BubbleSim::makeBallView(const Ball& ball) const {
+    return { ball.position, ball.radius, paletteColor(ball.color), ball.type, ball.bombRadius, ball.isStuck };
+}
+
+int16_t BubbleSim::quantize(float value, float scale) {
+    float scaled = value * scale;
+    if (scaled > 32767.0f) scaled = 32767.0f;
+    if (scaled < -32768.0f) scaled = -32768.0f;
+    return static_cast<int16_t>(lrintf(scaled));
+}
+
+PackedBall BubbleSim::packBall(const Ball& ball) const {
+    PackedBall packed;
+    packed.positionX = quantize(ball.position.x, 16.0f);
+    packed.positionY = quantize(ball.position.y, 16.0f);
+    packed.velocityX = quantize(ball.velocity.x, 256.0f);
+    packed.velocityY = quantize(ball.velocity.y, 256.0f);
+    packed.originX = quantize(ball.originalPosition.x, 16.0f);
+    packed.originY = quantize(ball.originalPosition.y, 16.0f);
+    packed.paletteIndex = traitsOf(ball.type).savesColor ? ball.color & colorIndexMask : paletteNone;
+    packed.flags = static_cast<uint8_t>((ball.active ? packedActive : 0) |
+        (ball.isStuck ? packedStuck : 0) |
+        (ball.hasSupport ? packedSupport : 0) |
+        (static_cast<int>(ball.type) << packedTypeShift));
+    return packed;
+}
+
+Ball BubbleSim::unpackBall(const PackedBall& packed) const {
+    BallType type = static_cast<BallType>((packed.flags >> packedTypeShift) & 0x3);
+    BallColor color = packed.paletteIndex < ballPalette.size() ? packed.paletteIndex : 0;
+
+    Ball ball(packed.positionX / 16.0f, packed.positionY / 16.0f, ballRadius, color, type);
+    if (traitsOf(type).savesColor) {
+        ball.color = static_cast<BallColor>(traitsOf(type).colorFlags | color);
+    }
+    ball.velocity = { packed.velocityX / 256.0f, packed.velocityY / 256.0f };
+    ball.originalPosition = { packed.originX / 16.0f, packed.originY / 16.0f };
+    ball.active = (packed.flags & packedActive) != 0;
+    ball.isStuck = (packed.flags & packedStuck) != 0;
+    ball.hasSupport = (packed.flags & packedSupport) != 0;
+    return ball;
+}
+
+void BubbleSim::saveState(std::vector<uint8_t>& out, bool includeParticles) const {
+    SaveStateHeader header = makeSaveStateHeader(includeParticles);
+
+    size_t total = sizeof(header) + balls.size() * sizeof(PackedBall) +
+        (currentBall ? sizeof(PackedBall) : 0) + header.particleCount * sizeof(PackedParticle);
+    out.resize(total);
+    uint8_t* cursor = out.data();
+
+    writeBytes(cursor, header);
+    if (currentBall) {
+        writeBytes(cursor, packBall(*currentBall));
+    }
+    for (const auto& ball : balls) {
+        writeBytes(cursor, packBall(ball));
+    }
+
+    if (includeParticles) {
+        for (const auto& particle : particles) {
+            PackedParticle packed;
+            packed.positionX = quantize(particle.position.x, 16.0f);
+            packed.positionY = quantize(particle.position.y, 16.0f);
+            packed.velocityX = quantize(particle.velocity.x, 256.0f);
+            packed.velocityY = quantize(particle.velocity.y, 256.0f);
+            packed.color = particle.color;
+            packed.size = static_cast<uint16_t>(particle.size * 256.0f);
+            packed.life = static_cast<uint16_t>(particle.life * 4096.0f);
+            writeBytes(cursor, packed);
+        }
+    }
+}
+
+SaveStateHeader BubbleSim::makeSaveStateHeader(bool includeParticles) const {
+    SaveStateHeader header{};
+    std::memcpy(header.magic, "BBST", 4);
+    header.version = saveStateVersion;
+    header.flags = static_cast<uint16_t>((includeParticles ? saveHasParticles : 0) |
+        (currentBall ? saveHasProjectile : 0));
+    header.score = score;
+    header.currentLevel = currentLevel;
+    header.rngState = rng.state;
+    header.boardSeed = boardSeed;
+    header.rainbowTimer = rainbowTimer;
+    header.aimDirectionX = quantize(aimDirection.x, 16384.0f);
+    header.aimDirectionY = quantize(aimDirection.y, 16384.0f);
+    header.gameState = static_cast<uint8_t>(gameState);
+    header.isLevelMode = isLevelMode ? 1 : 0;
+    header.isAiming = isAiming ? 1 : 0;
+    header.ballCount = static_cast<uint32_t>(balls.size());
+    header.particleCount = includeParticles ? static_cast<uint32_t>(particles.size()) : 0;
+    return header;
+}
+
+bool BubbleSim::loadState(const uint8_t* data, size_t size) {
+    TraceScope scope("loadState");
+    SaveStateHeader header;
+    if (size < sizeof(header)) return false;
+    std::memcpy(&header, data, sizeof(header));
+
+    if (std::memcmp(header.magic, "BBST", 4) != 0 || header.version != saveStateVersion) {
+        return false;
+    }
+
+    bool hasProjectile = (header.flags & saveHasProjectile) != 0;
+    size_t expected = sizeof(header) + header.ballCount * sizeof(PackedBall) +
+        (hasProjectile ? sizeof(PackedBall) : 0) + header.particleCount * sizeof(PackedParticle);
+    if (size < expected || header.gameState > GAME_WON) {
+        return false;
+    }
+
+    const uint8_t* cursor = data + sizeof(header);
+    PackedBall packed;
+
+    currentBall.reset();
+    if (hasProjectile) {
+        std::memcpy(&packed, cursor, sizeof(packed));
+        cursor += sizeof(packed);
+        currentBall.emplace(unpackBall(packed));
+    }
+
+    balls.clear();
+    for (uint32_t i = 0; i < header.ballCount; i++) {
+        std::memcpy(&packed, cursor, sizeof(packed));
+        cursor += sizeof(packed);
+        balls.push_back(unpackBall(packed));
+    }
+
+    occupancy.rebuild(balls);
+
+    particles.clear();
+    for (uint32_t i = 0; i < header.particleCount; i++) {
+        PackedParticle packedParticle;
+        std::memcpy(&packedParticle, cursor, sizeof(packedParticle));
+        cursor += sizeof(packedParticle);
+
+        Particle particle;
+        particle.position = { packedParticle.positionX / 16.0f, packedParticle.positionY / 16.0f };
+        particle.velocity = { packedParticle.velocityX / 256.0f, packedParticle.velocityY / 256.0f };
+        particle.color = packedParticle.color;
+        particle.size = packedParticle.size / 256.0f;
+        particle.life = packedParticle.life / 4096.0f;
+        particles.push_back(particle);
+    }
+
+    score = header.score;
+    currentLevel = header.currentLevel;
+    rng.state = header.rngState;
+    boardSeed = header.boardSeed;
+    rainbowTimer = header.rainbowTimer;
+    aimDirection = { header.aimDirectionX / 16384.0f, header.aimDirectionY / 16384.0f };
+    gameState = static_cast<GameState>(header.gameState);
+    isLevelMode = header.isLevelMode != 0;
+    isAiming = header.isAiming != 0;
+    applySpecialBallChances(isLevelMode);
+    nextBoardWanted = true;
+    return true;
+}
+
+bool BubbleSim::saveStateFile(const char* path) const {
+    std::vector<uint8_t> bytes;
+    saveState(bytes, true);
+    return writeFile(path, bytes);
+}
+
+bool BubbleSim::loadStateFile(const char* path) {
+    std::vector<uint8_t> bytes;
+    if (!readFile(path, bytes) || !loadState(bytes.data(), bytes.size())) return false;
+
+    checkpoint = std::move(bytes);
+    resetRewindHistory();
+    return true;
+}
+
+void BubbleSim::restart() {
+    TraceScope scope("restart");
+    balls.clear();
+    occupancy.rebuild(balls);
+    particles.clear();
+    currentBall.reset();
+    score = 0;
+    if (gameState == PLAYING) {
+        createInitialBalls(isLevelMode);
+        createNewBall();
+    }
+    resetRewindHistory();
+    nextBoardWanted = true;
+}
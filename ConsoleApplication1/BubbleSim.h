@@ -0,0 +1,272 @@
+#pragma once
+
+#include "SimCore.h"
+#include "RewindBuffer.h"
+#include "BoardGenerator.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <thread>
+#include <vector>
+
+// How the stuck cluster is held together: the original spring forces, or
+// position-based constraints projected solverIterations times per tick.
+enum ClusterSolver {
+    SOLVER_SPRINGS,
+    SOLVER_PBD
+};
+
+struct SimConfig {
+    uint64_t seed = 0;
+    float simulationRate = 60.0f;
+    size_t rewindBudgetBytes = 1024 * 1024;
+    uint32_t rewindKeyframeInterval = 60;
+    bool effects = true;
+    ClusterSolver solver = SOLVER_SPRINGS;
+    int solverIterations = 4;
+    uint32_t reorderInterval = 300;
+};
+
+// Game rules and physics without any raylib dependency. The game feeds one
+// InputState per tick and renders from the snapshots it fills; tests and
+// benchmarks drive it the same way without a window.
+class BubbleSim {
+public:
+    static constexpr int screenWidth = 450;
+    static constexpr int screenHeight = 800;
+    static constexpr float ballRadius = 15.0f;
+
+    static constexpr float gameAreaLeft = 10.0f;
+    static constexpr float gameAreaTop = 60.0f;
+    static constexpr float gameAreaRight = 440.0f;
+    static constexpr float gameAreaBottom = 750.0f;
+    static constexpr float gameAreaWidth = 430.0f;
+    static constexpr float gameAreaHeight = 690.0f;
+
+    static constexpr Vector2 newBallPosition = { screenWidth / 2.0f, gameAreaBottom - 30.0f };
+
+    static constexpr const char* quickSaveFile = "quicksave.bbs";
+
+    // While aiming, the ball moves aimSmoothing of the way to aimTarget()
+    // each tick. Public so the renderer can draw the aim from a fresher
+    // mouse sample than the last tick saw.
+    static constexpr float aimSmoothing = 0.3f;
+    static Vector2 aimTarget(Vector2 mousePosition);
+    static Vector2 aimDirectionFrom(Vector2 ballPosition);
+
+private:
+    static constexpr float shootSpeed = 17.0f;
+    static constexpr float minVelocity = 0.1f;
+
+    static constexpr float connectionStrength = 0.05f;
+    static constexpr float magnetStrength = 0.3f;
+    static constexpr float maxMagnetDistance = 60.0f;
+    static constexpr float separationForce = 0.1f;
+    static constexpr float maxBallSpeed = 2.0f;
+    static constexpr float antiGravity = -0.2f;
+    static constexpr float clusterMagnetStrength = 2.0f;
+
+    static constexpr float pbdNeighbourRange = 2.8f;
+    static constexpr float pbdBondRange = 2.2f;
+    static constexpr float pbdBondStiffness = 0.3f;
+    static constexpr float pbdAnchorStiffness = 0.01f;
+    static constexpr float pbdSleepDistance = 0.02f;
+
+    static constexpr size_t reorderAfterRemoved = 8;
+    static constexpr float maxClusterMagnetDistance = 300.0f;
+
+    static constexpr uint16_t saveStateVersion = 2;
+    static constexpr uint8_t paletteNone = 0xFF;
+    static constexpr uint8_t packedActive = 0x1;
+    static constexpr uint8_t packedStuck = 0x2;
+    static constexpr uint8_t packedSupport = 0x4;
+    static constexpr int packedTypeShift = 4;
+    static_assert(BALL_TYPE_COUNT <= 4, "packed balls keep the type in two bits");
+
+    BallList balls;
+    std::optional<Ball> currentBall;
+    bool isAiming;
+    Vector2 aimDirection;
+    int score;
+    GameState gameState;
+    int currentLevel;
+    bool isLevelMode;
+
+    int UNIVERSAL_CHANCE = 5;
+    int BOMB_CHANCE = 3;
+    int RAINBOW_CHANCE = 2;
+
+    ColorOccupancy occupancy;
+    BoardGenerator boardGenerator;
+
+    // Starting board of the level after the current one, built by
+    // boardWorker while this level is played. Only touched on the sim
+    // thread after the worker is joined.
+    struct NextBoard {
+        int level = 0;
+        uint32_t seed = 0;
+        BallList balls;
+        ColorOccupancy occupancy;
+        BoardGenerator generator;
+    };
+
+    uint32_t boardSeed = 0;
+    NextBoard nextBoard;
+    bool nextBoardWanted = false;
+    std::thread boardWorker;
+
+    BallList reorderScratch;
+    bool reorderPending = false;
+    ParticleList particles;
+    std::atomic<int> particlePercent{ 100 };
+    std::vector<SimEvent> events;
+    size_t dispatchedEvents = 0;
+    std::mt19937 effectsRng;
+    SimRng rng;
+    std::vector<uint8_t> checkpoint;
+
+    RewindBuffer rewind{ 1024 * 1024, 60 };
+    std::vector<PackedBall> rewindPacked;
+    std::vector<uint8_t> rewindState;
+    uint32_t simTick = 0;
+    // Ticks of the most recent shots; the oldest is dropped on overflow.
+    std::array<uint32_t, 16> shotTicks{};
+    size_t shotHead = 0;
+    size_t shotCount = 0;
+
+    SimConfig config;
+    InputState input;
+    float frameDelta;
+    float rainbowTimer;
+
+    FrameArena tickArena;
+
+    void createInitialBalls(bool isLevel);
+    void applySpecialBallChances(bool isLevel);
+    BallType getRandomBallType();
+    static void buildBoard(int level, uint32_t seed, BoardGenerator& generator, BallList& out);
+    void waitForBoardWorker();
+    void startNextBoard();
+    void advanceLevel();
+    BallColor pickColor(uint32_t colorMask);
+    void createNewBall();
+
+    void applyCommand();
+    void recordRewindFrame();
+    void resetRewindHistory();
+    uint32_t lastShotTick() const;
+    void handleGlobalKeys();
+    void update();
+    void updateParticles();
+    void createExplosion(Vector2 position, Color color, int count = 30);
+    void emit(SimEventType type, const Ball& ball, int count = 0, SimEventType source = EVENT_POP);
+    void dispatchEvents();
+    void applyScoring(const SimEvent* batch, size_t count);
+    void spawnEffects(const SimEvent* batch, size_t count);
+    void updateGame();
+    void updateRainbowBalls();
+    void handleAiming();
+    void shootBall();
+    void updatePhysics();
+    void applyMagnetForces(Ball& movingBall);
+    void applyClusterMagnetForces();
+    void checkSupport();
+    void applyAntiGravity();
+    void updateBallPhysics();
+    void resolveOverlaps();
+    void updateConnections();
+    void applyDampingAndLimits();
+    void solveClusterConstraints();
+    void clampToGameArea(Ball& ball);
+    void checkCollisions();
+    void compactBalls();
+    void maintainBallOrder();
+    void reorderBalls();
+    void activateBomb(Ball& bomb);
+    void activateRainbow(Ball& rainbowBall);
+    void checkBallGroups();
+    void applyGentleRemovalImpulse();
+    void findConnectedBalls(int startIndex, std::pmr::vector<int>& group, std::pmr::vector<uint8_t>& keys,
+        std::pmr::vector<bool>& visited);
+    void checkGameOver();
+    void checkLevelComplete();
+
+    BallView makeBallView(const Ball& ball) const;
+    static int16_t quantize(float value, float scale);
+    PackedBall packBall(const Ball& ball) const;
+    Ball unpackBall(const PackedBall& packed) const;
+    SaveStateHeader makeSaveStateHeader(bool includeParticles) const;
+
+public:
+    explicit BubbleSim(const SimConfig& simConfig);
+    BubbleSim(const BubbleSim&) = delete;
+    BubbleSim& operator=(const BubbleSim&) = delete;
+    ~BubbleSim();
+
+    void tick(const InputState& tickInput, float dt);
+    void fillSnapshot(RenderSnapshot& snapshot) const;
+
+    void startEndless();
+    void startLevel(int level);
+    void restart();
+    bool rewindTo(uint32_t targetTick);
+
+    void saveState(std::vector<uint8_t>& out, bool includeParticles) const;
+    bool loadState(const uint8_t* data, size_t size);
+    bool saveStateFile(const char* path) const;
+    bool loadStateFile(const char* path);
+
+    const LevelTable& getLevels() const {
+        return levelTable;
+    }
+
+    GameState getGameState() const {
+        return gameState;
+    }
+
+    int getScore() const {
+        return score;
+    }
+
+    int getCurrentLevel() const {
+        return currentLevel;
+    }
+
+    size_t getBallCount() const {
+        return balls.size();
+    }
+
+    const ColorCounts& getColorCounts() const {
+        return occupancy.getCounts();
+    }
+
+    size_t getParticleCount() const {
+        return particles.size();
+    }
+
+    // Share of the usual particle count each explosion spawns. Particles
+    // are cosmetic, so the game may lower this from the window thread when
+    // frames run over budget.
+    void setParticlePercent(int percent) {
+        particlePercent.store(percent, std::memory_order_relaxed);
+    }
+
+    bool isWaitingToShoot() const {
+        return isAiming && currentBall.has_value();
+    }
+
+    // Events of the last tick, for consumers outside the simulation.
+    const std::vector<SimEvent>& getEvents() const {
+        return events;
+    }
+
+    uint32_t getSimTick() const {
+        return simTick;
+    }
+
+    const RewindBuffer& getRewind() const {
+        return rewind;
+    }
+};
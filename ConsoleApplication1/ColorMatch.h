@@ -0,0 +1,75 @@
+#pragma once
+
+#include "SimCore.h"
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BUBBLE_COLOR_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define BUBBLE_COLOR_NEON 1
+#endif
+
+// Match kernels over packed colour keys, one byte per ball. Each call looks
+// at colorBatch keys and returns a bit per key; key arrays are padded with
+// colorIgnore to a multiple of colorBatch so the last batch can be read
+// whole.
+inline constexpr size_t colorBatch = 16;
+
+inline size_t paddedColorCount(size_t count) {
+    return (count + colorBatch - 1) & ~(colorBatch - 1);
+}
+
+#if defined(BUBBLE_COLOR_NEON)
+inline uint32_t neonMoveMask(uint8x16_t lanes) {
+    static const uint8_t weights[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+    uint8x16_t bits = vandq_u8(lanes, vld1q_u8(weights));
+    return static_cast<uint32_t>(vaddv_u8(vget_low_u8(bits))) |
+        (static_cast<uint32_t>(vaddv_u8(vget_high_u8(bits))) << 8);
+}
+#endif
+
+// Keys equal to `target`.
+inline uint32_t matchColorExact(const uint8_t* keys, uint8_t target) {
+#if defined(BUBBLE_COLOR_SSE2)
+    __m128i lanes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys));
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(lanes, _mm_set1_epi8(static_cast<char>(target)))));
+#elif defined(BUBBLE_COLOR_NEON)
+    return neonMoveMask(vceqq_u8(vld1q_u8(keys), vdupq_n_u8(target)));
+#else
+    uint32_t bits = 0;
+    for (size_t i = 0; i < colorBatch; i++) {
+        if (keys[i] == target) bits |= 1u << i;
+    }
+    return bits;
+#endif
+}
+
+// Keys equal to `target` or carrying a wild flag.
+inline uint32_t matchColorOrWild(const uint8_t* keys, uint8_t target) {
+#if defined(BUBBLE_COLOR_SSE2)
+    __m128i lanes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys));
+    __m128i equal = _mm_cmpeq_epi8(lanes, _mm_set1_epi8(static_cast<char>(target)));
+    __m128i tame = _mm_cmpeq_epi8(_mm_and_si128(lanes, _mm_set1_epi8(static_cast<char>(colorWildMask))),
+        _mm_setzero_si128());
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(equal, _mm_xor_si128(tame, _mm_set1_epi8(-1)))));
+#elif defined(BUBBLE_COLOR_NEON)
+    uint8x16_t lanes = vld1q_u8(keys);
+    uint8x16_t equal = vceqq_u8(lanes, vdupq_n_u8(target));
+    uint8x16_t wild = vtstq_u8(lanes, vdupq_n_u8(colorWildMask));
+    return neonMoveMask(vorrq_u8(equal, wild));
+#else
+    uint32_t bits = 0;
+    for (size_t i = 0; i < colorBatch; i++) {
+        if (keys[i] == target || (keys[i] & colorWildMask)) bits |= 1u << i;
+    }
+    return bits;
+#endif
+}
+
+// Keys that are not masked out.
+inline uint32_t matchAnyColor(const uint8_t* keys) {
+    return ~matchColorExact(keys, colorIgnore) & ((1u << colorBatch) - 1);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Single-producer/single-consumer ring. Capacity must be a power of two.
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert((Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+    std::array<T, Capacity> items;
+    alignas(64) std::atomic<size_t> head{ 0 };
+    alignas(64) std::atomic<size_t> tail{ 0 };
+
+public:
+    bool push(const T& item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+
+        items[t & (Capacity - 1)] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& out) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+
+        out = items[h & (Capacity - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+};
+
+// Lock-free triple buffer: the writer always owns one slot, the reader owns
+// another, and the third is exchanged atomically. The reader only ever sees
+// the most recently published slot and never blocks the writer.
+template <typename T>
+class TripleBuffer {
+    static constexpr uint8_t indexMask = 0x3;
+    static constexpr uint8_t freshBit = 0x4;
+
+    T slots[3];
+    std::atomic<uint8_t> middle{ 1 };
+    uint8_t back = 0;
+    uint8_t front = 2;
+
+public:
+    T& writeSlot() {
+        return slots[back];
+    }
+
+    void publish() {
+        uint8_t previous = middle.exchange(static_cast<uint8_t>(back | freshBit), std::memory_order_acq_rel);
+        back = previous & indexMask;
+    }
+
+    const T& read() {
+        if (middle.load(std::memory_order_relaxed) & freshBit) {
+            uint8_t previous = middle.exchange(front, std::memory_order_acq_rel);
+            front = previous & indexMask;
+        }
+        return slots[front];
+    }
+};
@@ -1,131 +1,153 @@
 ﻿#include "raylib.h"
-#include <vector>
-#include <cmath>
+#include "rlgl.h"
+#include "BotSession.h"
+#include "BubbleSim.h"
+#include "Concurrency.h"
+#include "FramePacer.h"
+#include "InputLatency.h"
+#include "QualityController.h"
+#include "RaylibAudio.h"
+#include "StaticLayer.h"
+#include "Telemetry.h"
+#include "TextCache.h"
+#include "Trace.h"
 #include <algorithm>
-#include <random>
-#include <unordered_set>
-#include <memory>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <new>
 #include <string>
+#include <thread>
+#include <vector>
 
-enum GameState {
-    MAIN_MENU,
-    LEVEL_SELECT,
-    PLAYING,
-    GAME_OVER,
-    GAME_WON
-};
-
-enum BallType {
-    NORMAL,
-    UNIVERSAL,
-    BOMB,
-    RAINBOW
-};
+// With --track-allocs, counts the window thread's global heap allocations so
+// the debug overlay can show per-frame render churn. Worker threads never set
+// the flag, so their allocations stay out of the count.
+static thread_local bool countHeapAllocations = false;
+static thread_local uint64_t heapAllocationCount = 0;
 
-struct Level {
-    int levelNumber;
-    int targetScore;
-    int ballCount;
-    int specialBallChance;
-    bool allowBomb;
-    bool allowRainbow;
-    bool allowUniversal;
-    std::string name;
-    Color backgroundColor;
+void* operator new(size_t size) {
+    if (countHeapAllocations) heapAllocationCount++;
+    if (void* block = std::malloc(size ? size : 1)) {
+        return block;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* block) noexcept {
+    std::free(block);
+}
+
+void operator delete[](void* block) noexcept {
+    std::free(block);
+}
+
+void operator delete(void* block, size_t) noexcept {
+    std::free(block);
+}
+
+void operator delete[](void* block, size_t) noexcept {
+    std::free(block);
+}
+
+struct GameOptions {
+    bool threadedSimulation = false;
+    bool trackAllocations = false;
+    bool powerSave = false;
+    bool lowLatencyInput = false;
+    bool reportInputLatency = false;
+    double frameRate = 60.0;
+    bool matchDisplayRate = false;
+    bool reportFrameStats = false;
+    int qualityLevel = -1;
+    std::string telemetryPath = "telemetry.jsonl";
+    int renderBenchFrames = 0;
+    int renderBenchLevel = 0;
+    std::string captureDir;
+    std::string captureRawPath;
+    std::string tracePath;
+    SimConfig sim;
 };
 
-struct Ball {
-    Vector2 position;
-    Vector2 velocity;
-    Vector2 acceleration;
-    float radius;
-    Color color;
-    bool active;
-    bool isStuck;
-    float stiffness;
-    float damping;
-    Vector2 originalPosition;
-    bool hasSupport;
-    BallType type;
-    bool isSpecial;
-    int bombRadius;
-    Color originalColor;
-
-    Ball(float x, float y, float r, Color c, BallType t = NORMAL)
-        : position{ x, y }, velocity{ 0, 0 }, acceleration{ 0, 0 },
-        radius(r), color(c), active(true), isStuck(true),
-        stiffness(0.08f), damping(0.92f), originalPosition{ x, y },
-        hasSupport(true), type(t), isSpecial(t != NORMAL),
-        bombRadius(static_cast<int>(r * 3)), originalColor(c) {
-
-        if (type == UNIVERSAL) {
-            color = WHITE;
-            originalColor = WHITE;
-        }
-        else if (type == BOMB) {
-            color = BLACK;
-            originalColor = BLACK;
-        }
-        else if (type == RAINBOW) {
-            color = RED;
-            originalColor = RED;
-        }
-    }
+// Icon drawn over each ball type, indexed by BallType; plain balls have none.
+static constexpr std::array<const char*, BALL_TYPE_COUNT> ballIconFiles = {
+    nullptr,
+    "assets/universal_icon.png",
+    "assets/bomb_icon.png",
+    "assets/rainbow_icon.png"
 };
 
 class BallGame {
 private:
-    const int screenWidth = 450;
-    const int screenHeight = 800;
-    const float ballRadius = 15.0f;
-    const float shootSpeed = 17.0f;
-    const float minVelocity = 0.1f;
-
-    const float gameAreaLeft = 10.0f;
-    const float gameAreaTop = 60.0f;
-    const float gameAreaRight = 440.0f;
-    const float gameAreaBottom = 750.0f;
-    const float gameAreaWidth = 430.0f;
-    const float gameAreaHeight = 690.0f;
-
-    const float connectionStrength = 0.05f;
-    const float magnetStrength = 0.3f;
-    const float maxMagnetDistance = 60.0f;
-    const float separationForce = 0.1f;
-    const float maxBallSpeed = 2.0f;
-    const float antiGravity = -0.2f;
-    const float clusterMagnetStrength = 2.0f;
-    const float maxClusterMagnetDistance = 300.0f;
-
-    std::vector<Ball> balls;
-    Ball* currentBall;
-    bool isAiming;
-    Vector2 aimDirection;
-    int score;
-    GameState gameState;
-    int currentLevel;
-    std::vector<Level> levels;
-    bool isLevelMode;
-
-    Vector2 newBallPosition;
-
-    std::vector<Color> ballColors = {
-        RED, BLUE, GREEN, YELLOW, PURPLE, ORANGE, PINK, SKYBLUE, LIME, VIOLET
-    };
-
-    int UNIVERSAL_CHANCE = 5;
-    int BOMB_CHANCE = 3;
-    int RAINBOW_CHANCE = 2;
-
-    struct Particle {
-        Vector2 position;
-        Vector2 velocity;
-        Color color;
-        float size;
-        float life;
-    };
-
-    std::vector<Particle> particles;
+    static constexpr int screenWidth = BubbleSim::screenWidth;
+    static constexpr int screenHeight = BubbleSim::screenHeight;
+    static constexpr float ballRadius = BubbleSim::ballRadius;
+
+    static constexpr float gameAreaLeft = BubbleSim::gameAreaLeft;
+    static constexpr float gameAreaTop = BubbleSim::gameAreaTop;
+    static constexpr float gameAreaWidth = BubbleSim::gameAreaWidth;
+    static constexpr float gameAreaHeight = BubbleSim::gameAreaHeight;
+    static constexpr Vector2 newBallPosition = BubbleSim::newBallPosition;
+
+    GameOptions options;
+    BubbleSim sim;
+    InputState input;
+    InputState pendingInput;
+    float frameDelta;
+    std::atomic<bool> quitRequested{ false };
+    std::atomic<bool> simulationRunning{ false };
+
+    SpscQueue<InputState, 256> inputQueue;
+    TripleBuffer<RenderSnapshot> snapshots;
+    SpscQueue<SimEvent, 1024> eventQueue;
+
+    static constexpr int idleFramesBeforeSlowdown = 30;
+    static constexpr double idlePollRate = 15.0;
+
+    RenderSnapshot lastDrawn;
+    bool hasLastDrawn = false;
+    Vector2 lastMousePosition = { 0.0f, 0.0f };
+
+    FramePacer pacer;
+    InputLatency inputLatency;
+    uint32_t inputSerial = 0;
+    uint32_t latchedSerial = 0;
+    Vector2 stampedMousePosition = { 0.0f, 0.0f };
+    InputState lateInput{};
+    bool lateDebugToggle = false;
+
+    // Share of the frame interval the frame's own work may take before
+    // quality steps down.
+    static constexpr float qualityBudgetShare = 0.8f;
+    QualityController quality;
+
+    int idleFrames = 0;
+    int idleTicks = 0;
+
+    bool showDebugOverlay = false;
+    bool audioDeviceOpen = false;
+    int captureFrameIndex = 0;
+    std::FILE* captureRaw = nullptr;
+    float captureMs = 0.0f;
+    uint64_t frameAllocationMark = 0;
+    uint64_t allocationsLastFrame = 0;
+    int eventsLastFrame = 0;
+
+    RaylibAudioBackend audioBackend;
+    AudioEngine audio;
+
+    using Clock = std::chrono::steady_clock;
+    Telemetry telemetry;
+    std::atomic<uint64_t> simNanoseconds{ 0 };
+    std::array<float, PHASE_COUNT> phaseMs{};
 
     Texture2D menuBackgroundTexture;
     Texture2D gameBackgroundTexture;
@@ -133,9 +155,7 @@ private:
     Texture2D exitButtonTexture;
     Texture2D levelsButtonTexture;
     Texture2D logoTexture;
-    Texture2D universalIconTexture;
-    Texture2D bombIconTexture;
-    Texture2D rainbowIconTexture;
+    std::array<Texture2D, BALL_TYPE_COUNT> ballIcons{};
     Texture2D backButtonTexture;
 
     bool texturesLoaded = false;
@@ -144,1214 +164,463 @@ private:
     Rectangle levelsButtonRect;
     Rectangle exitButtonRect;
 
-public:
-    BallGame() : isAiming(false), score(0), gameState(MAIN_MENU),
-        currentBall(nullptr), currentLevel(1), isLevelMode(false) {
-        InitWindow(screenWidth, screenHeight, "BubbleBlast");
-        SetTargetFPS(60);
-
-        InitAudioDevice();
-        loadTextures();
-
-        initializeLevels();
-
-        newBallPosition = { static_cast<float>(screenWidth) / 2.0f, gameAreaBottom - 30.0f };
-
-        startButtonRect = { screenWidth / 2.0f - 100.0f, screenHeight / 2.0f, 200.0f, 70.0f };
-        levelsButtonRect = { screenWidth / 2.0f - 100.0f, screenHeight / 2.0f + 80.0f, 200.0f, 70.0f };
-        exitButtonRect = { screenWidth / 2.0f - 100.0f, screenHeight / 2.0f + 160.0f, 200.0f, 70.0f };
-
-        createInitialBalls(false);
-        createNewBall();
-    }
-
-    ~BallGame() {
-        if (currentBall) delete currentBall;
-
-        unloadTextures();
-        CloseAudioDevice();
-        CloseWindow();
-    }
-
-    void initializeLevels() {
-        levels.clear();
-
-        levels.push_back({
-            1,
-            500,
-            50,
-            0,
-            false,
-            false,
-            false,
-            "Tutorial",
-            DARKBLUE
-            });
-
-        levels.push_back({
-            2,
-            1000,
-            70,
-            5,
-            true,
-            false,
-            false,
-            "Easy Mode",
-            DARKGREEN
-            });
-
-        levels.push_back({
-            3,
-            2000,
-            90,
-            10,
-            true,
-            true,
-            false,
-            "Medium Challenge",
-            PURPLE
-            });
-
-        levels.push_back({
-            4,
-            3500,
-            110,
-            15,
-            true,
-            true,
-            true,
-            "Hard Level",
-            DARKPURPLE
-            });
-
-        levels.push_back({
-            5,
-            5000,
-            130,
-            20,
-            true,
-            true,
-            true,
-            "Expert Mode",
-            MAROON
-            });
-    }
-
-    void loadTextures() {
-        if (FileExists("assets/logo.png")) {
-            logoTexture = LoadTexture("assets/logo.png");
-        }
-        else {
-            logoTexture = { 0 };
-        }
-
-        if (FileExists("assets/menu_background.png")) {
-            menuBackgroundTexture = LoadTexture("assets/menu_background.png");
-        }
-        else {
-            menuBackgroundTexture = { 0 };
-        }
-
-        if (FileExists("assets/game_background.png")) {
-            gameBackgroundTexture = LoadTexture("assets/game_background.png");
-        }
-        else {
-            gameBackgroundTexture = { 0 };
-        }
-
-        if (FileExists("assets/start_button.png")) {
-            startButtonTexture = LoadTexture("assets/start_button.png");
-        }
-        else {
-            startButtonTexture = { 0 };
-        }
-
-        if (FileExists("assets/levels_button.png")) {
-            levelsButtonTexture = LoadTexture("assets/levels_button.png");
-        }
-        else {
-            levelsButtonTexture = { 0 };
-        }
-
-        if (FileExists("assets/exit_button.png")) {
-            exitButtonTexture = LoadTexture("assets/exit_button.png");
-        }
-        else {
-            exitButtonTexture = { 0 };
-        }
-
-        if (FileExists("assets/universal_icon.png")) {
-            universalIconTexture = LoadTexture("assets/universal_icon.png");
-        }
-        else {
-            universalIconTexture = { 0 };
-        }
-
-        if (FileExists("assets/bomb_icon.png")) {
-            bombIconTexture = LoadTexture("assets/bomb_icon.png");
-        }
-        else {
-            bombIconTexture = { 0 };
-        }
-
-        if (FileExists("assets/rainbow_icon.png")) {
-            rainbowIconTexture = LoadTexture("assets/rainbow_icon.png");
-        }
-        else {
-            rainbowIconTexture = { 0 };
-        }
-
-        if (FileExists("assets/back_button.png")) {
-            backButtonTexture = LoadTexture("assets/back_button.png");
-        }
-        else {
-            backButtonTexture = { 0 };
-        }
-
-        texturesLoaded = true;
-    }
-
-    void unloadTextures() {
-        if (logoTexture.id != 0) UnloadTexture(logoTexture);
-        if (menuBackgroundTexture.id != 0) UnloadTexture(menuBackgroundTexture);
-        if (gameBackgroundTexture.id != 0) UnloadTexture(gameBackgroundTexture);
-        if (startButtonTexture.id != 0) UnloadTexture(startButtonTexture);
-        if (levelsButtonTexture.id != 0) UnloadTexture(levelsButtonTexture);
-        if (exitButtonTexture.id != 0) UnloadTexture(exitButtonTexture);
-        if (universalIconTexture.id != 0) UnloadTexture(universalIconTexture);
-        if (bombIconTexture.id != 0) UnloadTexture(bombIconTexture);
-        if (rainbowIconTexture.id != 0) UnloadTexture(rainbowIconTexture);
-        if (backButtonTexture.id != 0) UnloadTexture(backButtonTexture);
-    }
-
-    void createInitialBalls(bool isLevel) {
-        balls.clear();
-
-        if (isLevel) {
-            if (currentLevel < 1 || currentLevel > static_cast<int>(levels.size())) {
-                currentLevel = 1;
-            }
-
-            Level& level = levels[static_cast<size_t>(currentLevel) - 1];
-
-            UNIVERSAL_CHANCE = level.allowUniversal ? 5 : 0;
-            BOMB_CHANCE = level.allowBomb ? 3 : 0;
-            RAINBOW_CHANCE = level.allowRainbow ? 2 : 0;
-
-            int ballsPerRow = static_cast<int>(gameAreaWidth / (ballRadius * 2.0f));
-            int rows = static_cast<int>(level.ballCount / ballsPerRow) + 1;
-
-            std::vector<std::vector<Color>> colorGrid(static_cast<size_t>(rows),
-                std::vector<Color>(static_cast<size_t>(ballsPerRow), BLACK));
-
-            for (int row = 0; row < rows; row++) {
-                for (int col = 0; col < ballsPerRow; col++) {
-                    colorGrid[static_cast<size_t>(row)][static_cast<size_t>(col)] = getColorForPosition(colorGrid, row, col);
-                }
-            }
-
-            float totalWidth = static_cast<float>(ballsPerRow) * ballRadius * 2.0f;
-            float startX = gameAreaLeft + (gameAreaWidth - totalWidth) / 2.0f + ballRadius;
-
-            int ballsCreated = 0;
-            for (int row = 0; row < rows && ballsCreated < level.ballCount; row++) {
-                for (int col = 0; col < ballsPerRow && ballsCreated < level.ballCount; col++) {
-                    float x = startX + static_cast<float>(col) * (ballRadius * 2.0f);
-                    float y = gameAreaTop + 10.0f + static_cast<float>(row) * (ballRadius * 2.0f);
-
-                    if (x + ballRadius < gameAreaRight && y + ballRadius < gameAreaBottom) {
-                        balls.emplace_back(x, y, ballRadius, colorGrid[static_cast<size_t>(row)][static_cast<size_t>(col)]);
-                        balls.back().hasSupport = (row == 0);
-                        ballsCreated++;
-                    }
-                }
-            }
-        }
-        else {
-            UNIVERSAL_CHANCE = 5;
-            BOMB_CHANCE = 3;
-            RAINBOW_CHANCE = 2;
-
-            int ballsPerRow = static_cast<int>(gameAreaWidth / (ballRadius * 2.0f));
-            int rows = 10;
-
-            std::vector<std::vector<Color>> colorGrid(static_cast<size_t>(rows),
-                std::vector<Color>(static_cast<size_t>(ballsPerRow), BLACK));
-
-            for (int row = 0; row < rows; row++) {
-                for (int col = 0; col < ballsPerRow; col++) {
-                    colorGrid[static_cast<size_t>(row)][static_cast<size_t>(col)] = getColorForPosition(colorGrid, row, col);
-                }
-            }
-
-            float totalWidth = static_cast<float>(ballsPerRow) * ballRadius * 2.0f;
-            float startX = gameAreaLeft + (gameAreaWidth - totalWidth) / 2.0f + ballRadius;
-
-            for (int row = 0; row < rows; row++) {
-                for (int col = 0; col < ballsPerRow; col++) {
-                    float x = startX + static_cast<float>(col) * (ballRadius * 2.0f);
-                    float y = gameAreaTop + 10.0f + static_cast<float>(row) * (ballRadius * 2.0f);
-
-                    if (x + ballRadius < gameAreaRight && y + ballRadius < gameAreaBottom) {
-                        balls.emplace_back(x, y, ballRadius, colorGrid[static_cast<size_t>(row)][static_cast<size_t>(col)]);
-                        balls.back().hasSupport = (row == 0);
-                    }
-                }
-            }
-        }
-    }
-
-    BallType getRandomBallType() {
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<> chanceDist(0, 99);
-
-        int chance = chanceDist(gen);
-
-        if (chance < RAINBOW_CHANCE) {
-            return RAINBOW;
-        }
-        else if (chance < RAINBOW_CHANCE + BOMB_CHANCE) {
-            return BOMB;
-        }
-        else if (chance < RAINBOW_CHANCE + BOMB_CHANCE + UNIVERSAL_CHANCE) {
-            return UNIVERSAL;
-        }
-
-        return NORMAL;
-    }
-
-    Color getColorForPosition(std::vector<std::vector<Color>>& grid, int row, int col) {
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<> colorDist(0, static_cast<int>(ballColors.size()) - 1);
-
-        for (int attempt = 0; attempt < 50; attempt++) {
-            Color candidate = ballColors[static_cast<size_t>(colorDist(gen))];
-
-            if (isColorSafe(grid, row, col, candidate)) {
-                return candidate;
-            }
-        }
-
-        return getFallbackColor(grid, row, col);
-    }
-
-    bool isColorSafe(std::vector<std::vector<Color>>& grid, int row, int col, Color color) {
-        if (col >= 2) {
-            Color left1 = grid[static_cast<size_t>(row)][static_cast<size_t>(col - 1)];
-            Color left2 = grid[static_cast<size_t>(row)][static_cast<size_t>(col - 2)];
-            if (colorsEqual(color, left1) && colorsEqual(color, left2)) {
-                return false;
-            }
-        }
-
-        if (row >= 2) {
-            Color above1 = grid[static_cast<size_t>(row - 1)][static_cast<size_t>(col)];
-            Color above2 = grid[static_cast<size_t>(row - 2)][static_cast<size_t>(col)];
-            if (colorsEqual(color, above1) && colorsEqual(color, above2)) {
-                return false;
-            }
-        }
-
-        return true;
-    }
-
-    Color getFallbackColor(std::vector<std::vector<Color>>& grid, int row, int col) {
-        std::random_device rd;
-        std::mt19937 gen(rd());
-
-        for (size_t i = 0; i < ballColors.size(); i++) {
-            Color candidate = ballColors[i];
-            bool safeFromImmediate = true;
-
-            if (col >= 1 && colorsEqual(candidate, grid[static_cast<size_t>(row)][static_cast<size_t>(col - 1)])) {
-                safeFromImmediate = false;
-            }
-
-            if (row >= 1 && colorsEqual(candidate, grid[static_cast<size_t>(row - 1)][static_cast<size_t>(col)])) {
-                safeFromImmediate = false;
-            }
-
-            if (safeFromImmediate) {
-                return candidate;
-            }
-        }
-
-        std::uniform_int_distribution<> colorDist(0, static_cast<int>(ballColors.size()) - 1);
-        return ballColors[static_cast<size_t>(colorDist(gen))];
-    }
-
-    void createNewBall() {
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<> colorDist(0, static_cast<int>(ballColors.size()) - 1);
-
-        if (currentBall) {
-            delete currentBall;
-            currentBall = nullptr;
-        }
-
-        BallType ballType = getRandomBallType();
-        Color ballColor = ballColors[static_cast<size_t>(colorDist(gen))];
-
-        currentBall = new Ball(newBallPosition.x, newBallPosition.y, ballRadius,
-            ballColor, ballType);
-        currentBall->isStuck = false;
-        currentBall->originalPosition = newBallPosition;
-        currentBall->hasSupport = true;
-        isAiming = true;
-    }
-
-    void update() {
-        updateParticles();
-
-        if (gameState == MAIN_MENU) {
-            updateMainMenu();
-        }
-        else if (gameState == LEVEL_SELECT) {
-            updateLevelSelect();
-        }
-        else if (gameState == PLAYING) {
-            updateGame();
-        }
-    }
-
-    void updateParticles() {
-        for (auto it = particles.begin(); it != particles.end(); ) {
-            it->position.x += it->velocity.x;
-            it->position.y += it->velocity.y;
-            it->life -= 0.02f;
-            it->size *= 0.98f;
-
-            if (it->life <= 0.0f) {
-                it = particles.erase(it);
-            }
-            else {
-                ++it;
-            }
-        }
-    }
-
-    void createExplosion(Vector2 position, Color color, int count = 30) {
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_real_distribution<float> dist(-3.0f, 3.0f);
-        std::uniform_real_distribution<float> lifeDist(0.5f, 1.5f);
-
-        for (int i = 0; i < count; i++) {
-            Particle p;
-            p.position = position;
-            p.velocity = { dist(gen), dist(gen) };
-            p.color = color;
-            p.size = 3.0f + static_cast<float>(rand() % 5);
-            p.life = lifeDist(gen);
-            particles.push_back(p);
-        }
-    }
-
-    void updateMainMenu() {
-        Vector2 mousePoint = GetMousePosition();
-
-        if (CheckCollisionPointRec(mousePoint, startButtonRect)) {
-            if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
-                isLevelMode = false;
-                gameState = PLAYING;
-                restart();
-            }
-        }
-
-        if (CheckCollisionPointRec(mousePoint, levelsButtonRect)) {
-            if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
-                gameState = LEVEL_SELECT;
-            }
-        }
-
-        if (CheckCollisionPointRec(mousePoint, exitButtonRect)) {
-            if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
-                CloseWindow();
-            }
-        }
-    }
-
-    void updateLevelSelect() {
-        Vector2 mousePoint = GetMousePosition();
-
-        float buttonSize = 60.0f;
-        float buttonMargin = 20.0f;
-        Rectangle backButtonRect = {
-            screenWidth - buttonSize - buttonMargin,
-            screenHeight - buttonSize - buttonMargin,
-            buttonSize,
-            buttonSize
-        };
-
-        if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
-            if (CheckCollisionPointRec(mousePoint, backButtonRect)) {
-                gameState = MAIN_MENU;
-                return;
-            }
-
-            int levelButtonHeight = 70;
-            int startY = 100;
-
-            for (size_t i = 0; i < levels.size(); i++) {
-                Rectangle levelRect = { 50.0f, startY + static_cast<float>(i) * (levelButtonHeight + 10.0f),
-                                      screenWidth - 100.0f, static_cast<float>(levelButtonHeight) };
-
-                if (CheckCollisionPointRec(mousePoint, levelRect)) {
-                    isLevelMode = true;
-                    currentLevel = static_cast<int>(i) + 1;
-                    gameState = PLAYING;
-                    restart();
-                    break;
-                }
-            }
-        }
-
-        if (IsKeyPressed(KEY_ESCAPE)) {
-            gameState = MAIN_MENU;
-        }
-    }
-
-    void updateGame() {
-        updateRainbowBalls();
-
-        if (isAiming) {
-            handleAiming();
-            updateBallPhysics();
-        }
-        else {
-            updatePhysics();
-            checkCollisions();
-            updateBallPhysics();
-            checkSupport();
-            applyClusterMagnetForces();
-            applyAntiGravity();
-            checkGameOver();
-            if (isLevelMode) {
-                checkLevelComplete();
-            }
-        }
-    }
-
-    void updateRainbowBalls() {
-        static float rainbowTimer = 0.0f;
-        rainbowTimer += GetFrameTime();
-
-        if (rainbowTimer > 0.1f) {
-            rainbowTimer = 0.0f;
-
-            for (auto& ball : balls) {
-                if (ball.type == RAINBOW && ball.active) {
-                    if (ball.color.r == 255 && ball.color.g == 0 && ball.color.b == 0) ball.color = ORANGE;
-                    else if (ball.color.r == 255 && ball.color.g < 255 && ball.color.b == 0) ball.color = YELLOW;
-                    else if (ball.color.r == 255 && ball.color.g == 255 && ball.color.b == 0) ball.color = GREEN;
-                    else if (ball.color.r == 0 && ball.color.g == 255 && ball.color.b == 0) ball.color = SKYBLUE;
-                    else if (ball.color.r == 0 && ball.color.g == 255 && ball.color.b == 255) ball.color = BLUE;
-                    else if (ball.color.r == 0 && ball.color.g == 0 && ball.color.b == 255) ball.color = PURPLE;
-                    else if (ball.color.r == 255 && ball.color.g == 0 && ball.color.b == 255) ball.color = RED;
-                    ball.originalColor = ball.color;
-                }
-            }
-        }
-    }
-
-    void handleAiming() {
-        if (!currentBall) return;
-
-        Vector2 mousePos = GetMousePosition();
-
-        Vector2 targetPosition = {
-            mousePos.x,
-            mousePos.y
-        };
-
-        float maxAimDistance = 100.0f;
-        float dx = targetPosition.x - newBallPosition.x;
-        float dy = targetPosition.y - newBallPosition.y;
-        float distance = sqrtf(dx * dx + dy * dy);
-
-        if (distance > maxAimDistance) {
-            targetPosition.x = newBallPosition.x + (dx / distance) * maxAimDistance;
-            targetPosition.y = newBallPosition.y + (dy / distance) * maxAimDistance;
-        }
-
-        if (targetPosition.x - ballRadius < gameAreaLeft) {
-            targetPosition.x = gameAreaLeft + ballRadius;
-        }
-        else if (targetPosition.x + ballRadius > gameAreaRight) {
-            targetPosition.x = gameAreaRight - ballRadius;
-        }
-
-        if (targetPosition.y - ballRadius < gameAreaTop) {
-            targetPosition.y = gameAreaTop + ballRadius;
-        }
-        else if (targetPosition.y + ballRadius > gameAreaBottom) {
-            targetPosition.y = gameAreaBottom - ballRadius;
-        }
-
-        if (targetPosition.y > newBallPosition.y) {
-            targetPosition.y = newBallPosition.y;
-        }
+    StaticLayer menuLayer;
+    StaticLayer levelSelectLayer;
+    StaticLayer backdropLayer;
+    StaticLayer frameLayer{ true };
+    StaticLayer compositeLayer;
+    GameState layerState = MAIN_MENU;
+
+    TextCache text;
+    TextCache::Handle titleText;
+    TextCache::Handle startText;
+    TextCache::Handle levelsText;
+    TextCache::Handle exitText;
+    TextCache::Handle selectLevelText;
+    std::vector<TextCache::Handle> levelNameTexts;
+    std::vector<TextCache::Handle> levelTargetTexts;
+    std::vector<TextCache::Handle> levelDifficultyTexts;
+    TextCache::Handle levelTitleText;
+    TextCache::Handle levelScoreText;
+    TextCache::Handle endlessScoreText;
+    TextCache::Handle endlessModeText;
+    TextCache::Handle ballCountText;
+    std::vector<TextCache::Handle> colorCountTexts;
+    TextCache::Handle helpText;
+    TextCache::Handle progressText;
+    TextCache::Handle powerText;
+    TextCache::Handle gameOverText;
+    TextCache::Handle youWinText;
+    TextCache::Handle finalScoreText;
+    TextCache::Handle allLevelsText;
+    TextCache::Handle nextLevelText;
+    TextCache::Handle restartHintText;
+    TextCache::Handle continueHintText;
+    TextCache::Handle menuHintText;
 
-        float smoothSpeed = 0.3f;
-        currentBall->position.x += (targetPosition.x - currentBall->position.x) * smoothSpeed;
-        currentBall->position.y += (targetPosition.y - currentBall->position.y) * smoothSpeed;
-
-        aimDirection = {
-            currentBall->position.x - newBallPosition.x,
-            currentBall->position.y - newBallPosition.y
-        };
-
-        float length = sqrtf(aimDirection.x * aimDirection.x + aimDirection.y * aimDirection.y);
-        if (length > 0.0f) {
-            aimDirection.x /= length;
-            aimDirection.y /= length;
-        }
-
-        if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
-            shootBall();
+public:
+    explicit BallGame(const GameOptions& gameOptions) : options(gameOptions), sim(gameOptions.sim),
+        input{}, pendingInput{}, frameDelta(0.0f) {
+        allocTracker.enabled = options.trackAllocations;
+        countHeapAllocations = options.trackAllocations;
+        traceThreadName("main");
+        if (!options.tracePath.empty() && !traceStart(options.tracePath.c_str())) {
+            std::printf("cannot open %s\n", options.tracePath.c_str());
+        }
+
+        // The render bench draws as fast as it can into a hidden window and
+        // stays off the audio device and the telemetry file.
+        bool renderBench = options.renderBenchFrames > 0;
+        if (renderBench) {
+            SetConfigFlags(FLAG_WINDOW_HIDDEN);
+            options.lowLatencyInput = false;
         }
-    }
-
-    void shootBall() {
-        if (!currentBall) return;
-
-        float dx = currentBall->position.x - newBallPosition.x;
-        float dy = currentBall->position.y - newBallPosition.y;
-        float distance = sqrtf(dx * dx + dy * dy);
-        float power = distance / 50.0f;
-
-        if (power > 1.5f) power = 1.5f;
-        if (power < 0.3f) power = 0.3f;
-
-        currentBall->velocity = {
-            aimDirection.x * shootSpeed * power,
-            aimDirection.y * shootSpeed * power
-        };
-        currentBall->isStuck = false;
-        currentBall->hasSupport = false;
-        isAiming = false;
-    }
-
-    void updatePhysics() {
-        if (currentBall && !currentBall->isStuck) {
-            float currentSpeed = sqrtf(currentBall->velocity.x * currentBall->velocity.x +
-                currentBall->velocity.y * currentBall->velocity.y);
-            if (currentSpeed < 8.0f) {
-                applyMagnetForces(*currentBall);
-            }
-
-            currentBall->position.x += currentBall->velocity.x;
-            currentBall->position.y += currentBall->velocity.y;
-
-            if (currentBall->position.x - currentBall->radius < gameAreaLeft) {
-                currentBall->position.x = gameAreaLeft + currentBall->radius;
-                currentBall->velocity.x *= -0.7f;
-            }
-            else if (currentBall->position.x + currentBall->radius > gameAreaRight) {
-                currentBall->position.x = gameAreaRight - currentBall->radius;
-                currentBall->velocity.x *= -0.7f;
-            }
-
-            if (currentBall->position.y - currentBall->radius < gameAreaTop) {
-                currentBall->position.y = gameAreaTop + currentBall->radius;
-                currentBall->velocity.y *= -0.7f;
-            }
-
-            if (currentBall->position.y + currentBall->radius > gameAreaBottom) {
-                currentBall->position.y = gameAreaBottom - currentBall->radius;
-                currentBall->velocity.y *= -0.7f;
-            }
-
-            currentBall->velocity.x *= 0.99f;
-            currentBall->velocity.y *= 0.99f;
+        InitWindow(screenWidth, screenHeight, "BubbleBlast");
 
-            if (fabsf(currentBall->velocity.x) < minVelocity) currentBall->velocity.x = 0.0f;
-            if (fabsf(currentBall->velocity.y) < minVelocity) currentBall->velocity.y = 0.0f;
+        // Frames are paced here rather than by raylib's wait. The
+        // single-threaded loop ticks once per frame, so at any other rate
+        // than the simulation's the simulation gets its own thread.
+        SetTargetFPS(0);
+        double frameRate = options.frameRate;
+        if (options.matchDisplayRate) {
+            int refreshRate = GetMonitorRefreshRate(GetCurrentMonitor());
+            frameRate = refreshRate > 0 ? refreshRate : 60.0;
         }
-    }
-
-    void applyMagnetForces(Ball& movingBall) {
-        for (auto& ball : balls) {
-            if (!ball.active || !ball.isStuck) continue;
-
-            float dx = ball.position.x - movingBall.position.x;
-            float dy = ball.position.y - movingBall.position.y;
-            float distance = sqrtf(dx * dx + dy * dy);
-
-            if (distance < maxMagnetDistance && distance > ballRadius * 2.5f) {
-                float force = magnetStrength * (1.0f - distance / maxMagnetDistance);
-                force *= 0.3f;
-
-                float forceX = (dx / distance) * force;
-                float forceY = (dy / distance) * force;
-
-                movingBall.velocity.x += forceX;
-                movingBall.velocity.y += forceY;
-            }
+        pacer.setRate(renderBench ? 0.0 : frameRate);
+        if (!renderBench && std::fabs(pacer.getRate() - options.sim.simulationRate) > 0.5) {
+            options.threadedSimulation = true;
         }
-    }
 
-    void applyClusterMagnetForces() {
-        Vector2 clusterCenter = { 0.0f, 0.0f };
-        int clusterCount = 0;
-
-        for (auto& ball : balls) {
-            if (!ball.active || !ball.isStuck || !ball.hasSupport) continue;
-
-            clusterCenter.x += ball.position.x;
-            clusterCenter.y += ball.position.y;
-            clusterCount++;
+        // An uncapped frame rate has no budget to keep, and the render
+        // bench measures one fixed level.
+        if (options.qualityLevel >= 0) {
+            quality.pin(static_cast<QualityLevel>(options.qualityLevel));
         }
-
-        if (clusterCount == 0) {
-            clusterCenter = { screenWidth / 2.0f, gameAreaBottom - 100.0f };
-            clusterCount = 1;
+        else if (renderBench || !pacer.isCapped()) {
+            quality.pin(QUALITY_FULL);
         }
         else {
-            clusterCenter.x /= clusterCount;
-            clusterCenter.y /= clusterCount;
-        }
-
-        for (auto& ball : balls) {
-            if (!ball.active || !ball.isStuck || ball.hasSupport) continue;
-
-            float dx = clusterCenter.x - ball.position.x;
-            float dy = clusterCenter.y - ball.position.y;
-            float distance = sqrtf(dx * dx + dy * dy);
-
-            if (distance > ballRadius * 2.0f) {
-                float force = clusterMagnetStrength * (0.5f + distance / 100.0f);
-
-                if (distance > 100.0f) force *= 2.0f;
-
-                float forceX = (dx / distance) * force;
-                float forceY = (dy / distance) * force;
-
-                ball.velocity.x += forceX;
-                ball.velocity.y += forceY;
-
-                float speed = sqrtf(ball.velocity.x * ball.velocity.x + ball.velocity.y * ball.velocity.y);
-                if (speed > maxBallSpeed * 3.0f) {
-                    ball.velocity.x = (ball.velocity.x / speed) * maxBallSpeed * 3.0f;
-                    ball.velocity.y = (ball.velocity.y / speed) * maxBallSpeed * 3.0f;
-                }
-            }
-        }
-
-        if (currentBall && !currentBall->isStuck) {
-            float currentSpeed = sqrtf(currentBall->velocity.x * currentBall->velocity.x +
-                currentBall->velocity.y * currentBall->velocity.y);
-            if (currentSpeed < 10.0f) {
-                float dx = clusterCenter.x - currentBall->position.x;
-                float dy = clusterCenter.y - currentBall->position.y;
-                float distance = sqrtf(dx * dx + dy * dy);
-
-                if (distance > ballRadius * 3.0f) {
-                    float force = clusterMagnetStrength * 0.7f * (0.5f + distance / 100.0f);
-
-                    float forceX = (dx / distance) * force;
-                    float forceY = (dy / distance) * force;
-
-                    currentBall->velocity.x += forceX;
-                    currentBall->velocity.y += forceY;
-                }
-            }
-        }
-    }
-
-    void checkSupport() {
-        for (auto& ball : balls) {
-            if (!ball.active || !ball.isStuck) continue;
-            ball.hasSupport = false;
-        }
-
-        for (auto& ball : balls) {
-            if (!ball.active || !ball.isStuck) continue;
-            if (ball.position.y - ball.radius <= gameAreaTop + 1.0f) {
-                ball.hasSupport = true;
-            }
-        }
-
-        bool changed;
-        int maxIterations = 1000;
-        int iterations = 0;
-
-        do {
-            changed = false;
-            iterations++;
-
-            for (auto& ball : balls) {
-                if (!ball.active || !ball.isStuck || ball.hasSupport) continue;
-
-                for (const auto& other : balls) {
-                    if (!other.active || !other.isStuck || !other.hasSupport) continue;
-
-                    float dx = other.position.x - ball.position.x;
-                    float dy = other.position.y - ball.position.y;
-                    float distance = sqrtf(dx * dx + dy * dy);
-
-                    if (distance < ballRadius * 2.2f) {
-                        ball.hasSupport = true;
-                        changed = true;
-                        break;
-                    }
-                }
-            }
-
-            if (iterations >= maxIterations) {
-                break;
-            }
-        } while (changed);
-    }
-
-    void applyAntiGravity() {
-        for (auto& ball : balls) {
-            if (!ball.active || !ball.isStuck || ball.hasSupport) continue;
-
-            ball.velocity.y += antiGravity * 0.3f;
-
-            if (ball.velocity.y < -1.5f) {
-                ball.velocity.y = -1.5f;
-            }
-        }
-    }
-
-    void updateBallPhysics() {
-        resolveOverlaps();
-        updateConnections();
-        applyDampingAndLimits();
-    }
-
-    void resolveOverlaps() {
-        for (size_t i = 0; i < balls.size(); i++) {
-            if (!balls[i].active || !balls[i].isStuck) continue;
-
-            for (size_t j = i + 1; j < balls.size(); j++) {
-                if (!balls[j].active || !balls[j].isStuck) continue;
-
-                float dx = balls[j].position.x - balls[i].position.x;
-                float dy = balls[j].position.y - balls[i].position.y;
-                float distance = sqrtf(dx * dx + dy * dy);
-                float minDistance = balls[i].radius + balls[j].radius;
-
-                if (distance < minDistance && distance > 0.1f) {
-                    float overlap = (minDistance - distance) * 0.5f;
-                    float moveX = (dx / distance) * overlap * separationForce;
-                    float moveY = (dy / distance) * overlap * separationForce;
-
-                    balls[i].position.x -= moveX;
-                    balls[i].position.y -= moveY;
-                    balls[j].position.x += moveX;
-                    balls[j].position.y += moveY;
-                }
-            }
+            quality.setBudget(static_cast<float>(1000.0 / pacer.getRate()) * qualityBudgetShare);
         }
-    }
-
-    void updateConnections() {
-        for (size_t i = 0; i < balls.size(); i++) {
-            if (!balls[i].active || !balls[i].isStuck) continue;
-
-            Vector2 totalForce = { 0.0f, 0.0f };
-            int connectionCount = 0;
-
-            for (size_t j = 0; j < balls.size(); j++) {
-                if (i == j || !balls[j].active || !balls[j].isStuck) continue;
-
-                float dx = balls[j].position.x - balls[i].position.x;
-                float dy = balls[j].position.y - balls[i].position.y;
-                float distance = sqrtf(dx * dx + dy * dy);
-
-                if (distance < ballRadius * 2.8f) {
-                    float targetDistance = ballRadius * 2.0f;
-                    float displacement = distance - targetDistance;
-
-                    if (fabsf(displacement) > 0.5f) {
-                        float force = displacement * balls[i].stiffness;
-                        if (distance > ballRadius * 2.2f) {
-                            force *= 0.3f;
-                        }
-
-                        totalForce.x += (dx / distance) * force;
-                        totalForce.y += (dy / distance) * force;
-                        connectionCount++;
-                    }
-                }
-            }
-
-            float restoreForce = 0.01f;
-            totalForce.x += (balls[i].originalPosition.x - balls[i].position.x) * restoreForce;
-            totalForce.y += (balls[i].originalPosition.y - balls[i].position.y) * restoreForce;
-
-            if (connectionCount > 0 || restoreForce > 0.0f) {
-                balls[i].velocity.x += totalForce.x;
-                balls[i].velocity.y += totalForce.y;
-            }
-        }
-    }
-
-    void applyDampingAndLimits() {
-        for (auto& ball : balls) {
-            if (!ball.active || !ball.isStuck) continue;
-
-            ball.velocity.x *= ball.damping;
-            ball.velocity.y *= ball.damping;
-
-            float speed = sqrtf(ball.velocity.x * ball.velocity.x + ball.velocity.y * ball.velocity.y);
-            if (speed > maxBallSpeed) {
-                ball.velocity.x = (ball.velocity.x / speed) * maxBallSpeed;
-                ball.velocity.y = (ball.velocity.y / speed) * maxBallSpeed;
-            }
-
-            if (fabsf(ball.velocity.x) < 0.05f) ball.velocity.x = 0.0f;
-            if (fabsf(ball.velocity.y) < 0.05f) ball.velocity.y = 0.0f;
-
-            ball.position.x += ball.velocity.x;
-            ball.position.y += ball.velocity.y;
-
-            const float margin = 5.0f;
-            if (ball.position.x - ball.radius < gameAreaLeft + margin) {
-                ball.position.x = gameAreaLeft + ball.radius + margin;
-                ball.velocity.x = 0.0f;
-            }
-            else if (ball.position.x + ballRadius > gameAreaRight - margin) {
-                ball.position.x = gameAreaRight - ball.radius - margin;
-                ball.velocity.x = 0.0f;
-            }
-
-            if (ball.position.y - ball.radius < gameAreaTop) {
-                ball.position.y = gameAreaTop + ball.radius;
-                ball.velocity.y = 0.0f;
-                ball.hasSupport = true;
-            }
-
-            if (ball.position.y + ball.radius > gameAreaBottom) {
-                ball.position.y = gameAreaBottom - ball.radius;
-                ball.velocity.y = 0.0f;
-            }
-        }
-    }
-
-    void checkCollisions() {
-        if (!currentBall || currentBall->isStuck) return;
-
-        bool hasCollision = false;
-        Ball* closestBall = nullptr;
-        float minDistance = std::numeric_limits<float>::max();
-
-        for (auto& ball : balls) {
-            if (!ball.active || !ball.isStuck) continue;
-
-            float dx = currentBall->position.x - ball.position.x;
-            float dy = currentBall->position.y - ball.position.y;
-            float distance = sqrtf(dx * dx + dy * dy);
-
-            if (distance < currentBall->radius + ball.radius) {
-                if (distance < minDistance) {
-                    minDistance = distance;
-                    hasCollision = true;
-                    closestBall = &ball;
-                }
-            }
-        }
-
-        if (hasCollision && closestBall) {
-            currentBall->isStuck = true;
-            currentBall->hasSupport = closestBall->hasSupport;
-
-            float impactTransfer = 0.1f;
-            closestBall->velocity.x += currentBall->velocity.x * impactTransfer;
-            closestBall->velocity.y += currentBall->velocity.y * impactTransfer;
-
-            float dx = currentBall->position.x - closestBall->position.x;
-            float dy = currentBall->position.y - closestBall->position.y;
-            float distance = sqrtf(dx * dx + dy * dy);
-            float targetDistance = currentBall->radius + closestBall->radius;
-
-            if (distance > 0.0f) {
-                currentBall->position.x = closestBall->position.x + (dx / distance) * targetDistance;
-                currentBall->position.y = closestBall->position.y + (dy / distance) * targetDistance;
-                currentBall->originalPosition = currentBall->position;
-            }
-
-            if (currentBall->type == BOMB) {
-                activateBomb(*currentBall);
-                delete currentBall;
-                currentBall = nullptr;
-                createNewBall();
-                return;
-            }
-            else if (currentBall->type == RAINBOW) {
-                balls.push_back(*currentBall);
-                currentBall = nullptr;
-            }
-            else {
-                balls.push_back(*currentBall);
-                currentBall = nullptr;
-            }
-
-            checkBallGroups();
-
-            createNewBall();
-        }
-
-        if (currentBall && !currentBall->isStuck) {
-            if (currentBall->position.y > gameAreaBottom + 50.0f ||
-                currentBall->position.y < gameAreaTop - 50.0f ||
-                currentBall->position.x < gameAreaLeft - 50.0f ||
-                currentBall->position.x > gameAreaRight + 50.0f) {
+        applyQuality();
 
-                if (currentBall) {
-                    delete currentBall;
-                    currentBall = nullptr;
-                }
-                createNewBall();
+        if (!renderBench) {
+            InitAudioDevice();
+            audioDeviceOpen = true;
+            audio.init(audioBackend);
+            if (!options.telemetryPath.empty()) {
+                telemetry.open(options.telemetryPath.c_str());
             }
         }
-    }
+        loadTextures();
+        buildTextCache();
+
+        startButtonRect = { screenWidth / 2.0f - 100.0f, screenHeight / 2.0f, 200.0f, 70.0f };
+        levelsButtonRect = { screenWidth / 2.0f - 100.0f, screenHeight / 2.0f + 80.0f, 200.0f, 70.0f };
+        exitButtonRect = { screenWidth / 2.0f - 100.0f, screenHeight / 2.0f + 160.0f, 200.0f, 70.0f };
 
-    void handleSpecialBallCollision(Ball& specialBall) {
-        switch (specialBall.type) {
-        case UNIVERSAL:
-            break;
+        publishSnapshot();
+    }
 
-        case BOMB:
-            activateBomb(specialBall);
-            break;
+    ~BallGame() {
+        text.clear();
+        unloadLayers();
+        unloadTextures();
 
-        case RAINBOW:
-            break;
+        if (allocTracker.enabled) {
+            allocTracker.printSummary();
+        }
+        if (options.reportInputLatency) {
+            inputLatency.printSummary();
+        }
+        if (options.reportFrameStats) {
+            FrameStats stats = pacer.stats();
+            std::printf("frames: %u at %.1f Hz, mean %.3f ms, stddev %.3f ms, min %.3f ms, max %.3f ms, %u late\n",
+                stats.frames, pacer.getRate(), stats.meanMs, stats.stddevMs, stats.minMs, stats.maxMs, stats.missed);
+        }
 
-        case NORMAL:
-        default:
-            break;
+        telemetry.close();
+        traceStop();
+        audio.shutdown();
+        if (audioDeviceOpen) {
+            CloseAudioDevice();
         }
+        CloseWindow();
     }
 
-    void activateBomb(Ball& bomb) {
-        createExplosion(bomb.position, YELLOW, 50);
-
-        std::vector<size_t> toRemove;
-        for (size_t i = 0; i < balls.size(); i++) {
-            if (!balls[i].active) continue;
+    void loadTextures() {
+        TraceScope scope("loadTextures");
+        logoTexture = loadTextureIfExists("assets/logo.png");
+        menuBackgroundTexture = loadTextureIfExists("assets/menu_background.png");
+        gameBackgroundTexture = loadTextureIfExists("assets/game_background.png");
+        startButtonTexture = loadTextureIfExists("assets/start_button.png");
+        levelsButtonTexture = loadTextureIfExists("assets/levels_button.png");
+        exitButtonTexture = loadTextureIfExists("assets/exit_button.png");
+        for (size_t i = 0; i < ballIcons.size(); i++) {
+            if (ballIconFiles[i]) {
+                ballIcons[i] = loadTextureIfExists(ballIconFiles[i]);
+            }
+        }
+        backButtonTexture = loadTextureIfExists("assets/back_button.png");
 
-            float dx = balls[i].position.x - bomb.position.x;
-            float dy = balls[i].position.y - bomb.position.y;
-            float distance = sqrtf(dx * dx + dy * dy);
+        texturesLoaded = true;
+    }
 
-            if (distance < bomb.bombRadius) {
-                toRemove.push_back(i);
-            }
+    Texture2D loadTextureIfExists(const char* fileName) {
+        if (!FileExists(fileName)) {
+            return { 0 };
         }
 
-        for (size_t index : toRemove) {
-            balls[index].active = false;
-            createExplosion(balls[index].position, RED, 10);
+        Texture2D texture = LoadTexture(fileName);
+        if (texture.id != 0) {
+            allocTracker.recordAllocation(TAG_TEXTURES, textureBytes(texture));
         }
+        return texture;
+    }
 
-        balls.erase(std::remove_if(balls.begin(), balls.end(),
-            [](const Ball& ball) { return !ball.active; }),
-            balls.end());
+    static size_t textureBytes(const Texture2D& texture) {
+        return static_cast<size_t>(texture.width) * static_cast<size_t>(texture.height) * 4;
+    }
 
-        score += static_cast<int>(toRemove.size()) * 20;
+    void unloadTexture(Texture2D& texture) {
+        if (texture.id == 0) return;
 
-        applyGentleRemovalImpulse();
+        allocTracker.recordRelease(TAG_TEXTURES, textureBytes(texture));
+        UnloadTexture(texture);
+        texture = { 0 };
     }
 
-    void activateRainbow(Ball& rainbowBall) {
-        createExplosion(rainbowBall.position, rainbowBall.color, 40);
+    void drawBallIcon(BallType type, Vector2 position, float radius) {
+        const Texture2D& icon = ballIcons[type];
+        if (icon.id == 0) return;
 
-        std::vector<size_t> toRemove;
-        Color targetColor = rainbowBall.originalColor;
+        Rectangle dest = { position.x - radius, position.y - radius, radius * 2, radius * 2 };
+        DrawTexturePro(icon, { 0, 0, (float)icon.width, (float)icon.height }, dest, { 0, 0 }, 0.0f, WHITE);
+    }
 
-        for (size_t i = 0; i < balls.size(); i++) {
-            if (!balls[i].active) continue;
+    void unloadTextures() {
+        unloadTexture(logoTexture);
+        unloadTexture(menuBackgroundTexture);
+        unloadTexture(gameBackgroundTexture);
+        unloadTexture(startButtonTexture);
+        unloadTexture(levelsButtonTexture);
+        unloadTexture(exitButtonTexture);
+        for (Texture2D& icon : ballIcons) {
+            unloadTexture(icon);
+        }
+        unloadTexture(backButtonTexture);
+    }
 
-            if (colorsEqual(balls[i].color, targetColor)) {
-                toRemove.push_back(i);
-            }
-        }
+    void buildTextCache() {
+        TraceScope scope("buildTextCache");
+        titleText = text.addStatic("BubbleBlast", 50);
+        startText = text.addStatic("Start Game", 20);
+        levelsText = text.addStatic("Levels", 20);
+        exitText = text.addStatic("Exit", 20);
+        selectLevelText = text.addStatic("SELECT LEVEL", 40);
 
-        for (size_t index : toRemove) {
-            balls[index].active = false;
-            createExplosion(balls[index].position, targetColor, 5);
-        }
+        static const char* difficulties[] = { "★☆☆☆☆", "★★☆☆☆", "★★★☆☆", "★★★★☆", "★★★★★" };
+        const LevelTable& levels = sim.getLevels();
+        for (size_t i = 0; i < levels.size(); i++) {
+            const Level& level = levels[i];
+            levelNameTexts.push_back(text.addStatic(TextFormat("Level %d: %s", level.levelNumber, level.name), 22));
+            levelTargetTexts.push_back(text.addStatic(TextFormat("Target: %d points", level.targetScore), 16));
+            levelDifficultyTexts.push_back(text.addStatic(difficulties[i < 4 ? i : 4], 20));
+        }
+
+        levelTitleText = text.addDynamic(20);
+        levelScoreText = text.addDynamic(20);
+        endlessScoreText = text.addDynamic(20);
+        endlessModeText = text.addStatic("Endless Mode", 20);
+        ballCountText = text.addDynamic(20);
+        for (size_t i = 0; i < ballPalette.size(); i++) {
+            colorCountTexts.push_back(text.addDynamic(10));
+        }
+        helpText = text.addStatic("LMB - shoot, R - restart, M - menu, Z - undo", 15);
+        progressText = text.addDynamic(15);
+        powerText = text.addDynamic(12);
+
+        gameOverText = text.addStatic("GAME OVER!", 30);
+        youWinText = text.addStatic("YOU WIN!", 40);
+        finalScoreText = text.addDynamic(25);
+        allLevelsText = text.addStatic("All levels completed!", 25);
+        nextLevelText = text.addDynamic(25);
+        restartHintText = text.addStatic("Press R to restart", 20);
+        continueHintText = text.addStatic("Press R to continue", 20);
+        menuHintText = text.addStatic("Press M for Main Menu", 20);
+    }
 
-        for (size_t i = 0; i < balls.size(); i++) {
-            if (&balls[i] == &rainbowBall) {
-                balls[i].active = false;
-                break;
-            }
-        }
+    static uint64_t textKey(int high, int low) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(high)) << 32) | static_cast<uint32_t>(low);
+    }
 
-        balls.erase(std::remove_if(balls.begin(), balls.end(),
-            [](const Ball& ball) { return !ball.active; }),
-            balls.end());
+    static float millisecondsSince(Clock::time_point start) {
+        return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+    }
 
-        score += static_cast<int>(toRemove.size()) * 25;
+    void tick() {
+        Clock::time_point start = Clock::now();
+        sim.tick(input, frameDelta);
+        simNanoseconds.fetch_add(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count()),
+            std::memory_order_relaxed);
+        publishSnapshot();
+        publishEvents();
+        clearInputEdges(input);
+    }
 
-        applyGentleRemovalImpulse();
+    // Gameplay events reach the window side in tick order; if the render
+    // thread falls behind the overflow is dropped rather than blocking.
+    void publishEvents() {
+        for (const SimEvent& event : sim.getEvents()) {
+            if (!eventQueue.push(event)) break;
+        }
     }
 
-    void checkBallGroups() {
-        if (balls.empty()) return;
+    void consumeEvents() {
+        eventsLastFrame = 0;
+        SimEvent event;
+        int score = snapshots.read().score;
+        while (eventQueue.pop(event)) {
+            audio.queue(event);
+            telemetry.observe(event, score);
+            eventsLastFrame++;
+        }
+        audio.update();
+    }
 
-        std::vector<int> toRemove;
-        std::vector<bool> visited(balls.size(), false);
+    void publishSnapshot() {
+        sim.fillSnapshot(snapshots.writeSlot());
+        snapshots.publish();
+    }
 
-        for (size_t i = 0; i < balls.size(); i++) {
-            if (!balls[i].active || visited[i] || !balls[i].isStuck) continue;
+    // Menu hit-testing stays on the window side; the simulation only sees
+    // the resulting command.
+    void applyMenuInput(InputState& sample, GameState state) {
+        if (!sample.mouseLeftPressed) return;
 
-            std::vector<int> group;
-            findConnectedBalls(static_cast<int>(i), group, balls[i].color, visited, balls[i].type);
+        Vector2 mousePoint = sample.mousePosition;
 
-            if (group.size() >= 4 || balls[i].type == UNIVERSAL) {
-                if (balls[i].type == RAINBOW && group.size() >= 4) {
-                    activateRainbow(balls[static_cast<size_t>(group[0])]);
-                    return;
-                }
+        if (state == MAIN_MENU) {
+            if (CheckCollisionPointRec(mousePoint, startButtonRect)) {
+                sample.command = COMMAND_START_ENDLESS;
+            }
+            else if (CheckCollisionPointRec(mousePoint, levelsButtonRect)) {
+                sample.command = COMMAND_OPEN_LEVEL_SELECT;
+            }
+            else if (CheckCollisionPointRec(mousePoint, exitButtonRect)) {
+                quitRequested = true;
+            }
+        }
+        else if (state == LEVEL_SELECT) {
+            float buttonSize = 60.0f;
+            float buttonMargin = 20.0f;
+            Rectangle backButtonRect = {
+                screenWidth - buttonSize - buttonMargin,
+                screenHeight - buttonSize - buttonMargin,
+                buttonSize,
+                buttonSize
+            };
 
-                toRemove.insert(toRemove.end(), group.begin(), group.end());
-                score += static_cast<int>(group.size()) * 15;
+            if (CheckCollisionPointRec(mousePoint, backButtonRect)) {
+                sample.command = COMMAND_MAIN_MENU;
+                return;
+            }
 
-                if (group.size() >= 5) score += static_cast<int>(group.size()) * 10;
-                if (group.size() >= 7) score += static_cast<int>(group.size()) * 20;
-                if (group.size() >= 10) score += static_cast<int>(group.size()) * 30;
+            int levelButtonHeight = 70;
+            int startY = 100;
 
-                if (group.size() == 4) {
-                    score += 25;
-                }
+            for (size_t i = 0; i < sim.getLevels().size(); i++) {
+                Rectangle levelRect = { 50.0f, startY + static_cast<float>(i) * (levelButtonHeight + 10.0f),
+                                      screenWidth - 100.0f, static_cast<float>(levelButtonHeight) };
 
-                if (balls[i].type == UNIVERSAL) {
-                    score += 50;
+                if (CheckCollisionPointRec(mousePoint, levelRect)) {
+                    sample.command = COMMAND_START_LEVEL;
+                    sample.commandLevel = static_cast<int>(i) + 1;
+                    break;
                 }
             }
         }
+    }
 
-        for (int index : toRemove) {
-            balls[static_cast<size_t>(index)].active = false;
-            createExplosion(balls[static_cast<size_t>(index)].position,
-                balls[static_cast<size_t>(index)].color, 5);
-        }
-
-        if (!toRemove.empty()) {
-            balls.erase(std::remove_if(balls.begin(), balls.end(),
-                [](const Ball& ball) { return !ball.active; }),
-                balls.end());
+    void unloadLayers() {
+        menuLayer.unload();
+        levelSelectLayer.unload();
+        backdropLayer.unload();
+        frameLayer.unload();
+        compositeLayer.unload();
+    }
 
-            applyGentleRemovalImpulse();
+    template <typename Fill>
+    void drawLayer(StaticLayer& layer, int key, Fill fill) {
+        if (!layer.isCurrent(key)) {
+            layer.begin(screenWidth, screenHeight, key);
+            fill();
+            layer.end();
         }
+        layer.draw();
     }
 
-    void applyGentleRemovalImpulse() {
-        for (auto& ball : balls) {
-            if (ball.isStuck) {
-                int randomX = GetRandomValue(-5, 5);
-                int randomY = GetRandomValue(-5, 5);
-                ball.velocity.x += static_cast<float>(randomX) / 100.0f;
-                ball.velocity.y += static_cast<float>(randomY) / 100.0f;
-            }
+    void draw(const RenderSnapshot& view) {
+        TraceScope scope("draw");
+        if (view.gameState != layerState) {
+            menuLayer.invalidate();
+            levelSelectLayer.invalidate();
+            backdropLayer.invalidate();
+            frameLayer.invalidate();
+            compositeLayer.invalidate();
+            layerState = view.gameState;
         }
-    }
 
-    void findConnectedBalls(int startIndex, std::vector<int>& group, Color targetColor,
-        std::vector<bool>& visited, BallType ballType) {
-        if (visited[static_cast<size_t>(startIndex)]) return;
+        BeginDrawing();
 
-        visited[static_cast<size_t>(startIndex)] = true;
-        group.push_back(startIndex);
+        if (view.gameState == MAIN_MENU) {
+            drawMainMenu();
+        }
+        else if (view.gameState == LEVEL_SELECT) {
+            drawLevelSelect(view);
+        }
+        else if (view.gameState == PLAYING) {
+            drawGame(view);
+        }
+        else if (view.gameState == GAME_OVER || view.gameState == GAME_WON) {
+            drawGame(view);
+            drawEndScreen(view);
+        }
 
-        for (size_t i = 0; i < balls.size(); i++) {
-            if (visited[i] || !balls[i].active || !balls[i].isStuck) continue;
+        if (showDebugOverlay) {
+            drawDebugOverlay(view);
+        }
 
-            bool colorMatches = false;
-            if (ballType == UNIVERSAL) {
-                colorMatches = true;
-            }
-            else if (balls[i].type == UNIVERSAL) {
-                colorMatches = true;
-            }
-            else if (ballType == RAINBOW) {
-                colorMatches = true;
-            }
-            else if (balls[i].type == RAINBOW) {
-                colorMatches = true;
-            }
-            else {
-                colorMatches = colorsEqual(balls[i].color, targetColor);
-            }
+        if (!options.captureDir.empty() || captureRaw) {
+            captureFrame();
+        }
 
-            if (colorMatches) {
-                float dx = balls[i].position.x - balls[static_cast<size_t>(startIndex)].position.x;
-                float dy = balls[i].position.y - balls[static_cast<size_t>(startIndex)].position.y;
-                float distance = sqrtf(dx * dx + dy * dy);
+        EndDrawing();
+        inputLatency.presented(view.inputSerial, latchedSerial, Clock::now());
+    }
 
-                if (distance < ballRadius * 2.2f) {
-                    findConnectedBalls(static_cast<int>(i), group, targetColor, visited, ballType);
-                }
-            }
+    void updateQuality(float frameMs) {
+        QualityLevel before = quality.getLevel();
+        quality.update(frameMs);
+        if (quality.getLevel() != before) {
+            applyQuality();
         }
     }
 
-    bool colorsEqual(Color a, Color b) {
-        return a.r == b.r && a.g == b.g && a.b == b.b;
+    void applyQuality() {
+        sim.setParticlePercent(quality.settings().particlePercent);
+    }
+
+    // Circles at the current quality's segment count; at full quality
+    // these are raylib's own circles.
+    void drawDisc(Vector2 center, float radius, Color color) {
+        int segments = quality.settings().circleSegments;
+        if (segments == 0) {
+            DrawCircleV(center, radius, color);
+        }
+        else {
+            DrawCircleSector(center, radius, 0.0f, 360.0f, segments, color);
+        }
     }
 
-    void checkGameOver() {
-        if (balls.size() > 175) {
-            gameState = GAME_OVER;
+    void drawRing(Vector2 center, float radius, Color color) {
+        int segments = quality.settings().circleSegments;
+        if (segments == 0) {
+            DrawCircleLines(static_cast<int>(center.x), static_cast<int>(center.y), radius, color);
+        }
+        else {
+            DrawCircleSectorLines(center, radius, 0.0f, 360.0f, segments, color);
         }
     }
 
-    void checkLevelComplete() {
-        if (currentLevel < 1 || currentLevel > static_cast<int>(levels.size())) {
+    // EndDrawing() has already polled input, so presses it saw are kept
+    // before the wait and input is polled again after it; the next frame
+    // then starts from input as fresh as raylib's own wait would leave it.
+    void paceFrame() {
+        if (!pacer.isCapped()) {
+            pacer.wait();
             return;
         }
 
-        Level& level = levels[static_cast<size_t>(currentLevel) - 1];
+        InputState early = sampleInput();
+        stampInput(early);
+        lateDebugToggle = lateDebugToggle || IsKeyPressed(KEY_F3);
+        mergeInput(lateInput, early);
 
-        if (score >= level.targetScore) {
-            if (currentLevel < static_cast<int>(levels.size())) {
-                currentLevel++;
-                gameState = PLAYING;
-                restart();
-            }
-            else {
-                gameState = GAME_WON;
-            }
-        }
+        pacer.wait();
+        PollInputEvents();
     }
 
-    void draw() {
-        BeginDrawing();
+    // Reads the finished back buffer before it is swapped. Frames go to
+    // numbered PNGs, or are appended to one raw RGBA file that ffmpeg reads
+    // with -f rawvideo -pix_fmt rgba -s WIDTHxHEIGHT.
+    void captureFrame() {
+        TraceScope scope("captureFrame");
+        Clock::time_point start = Clock::now();
+        Image frame = LoadImageFromScreen();
 
-        if (gameState == MAIN_MENU) {
-            drawMainMenu();
-        }
-        else if (gameState == LEVEL_SELECT) {
-            drawLevelSelect();
+        if (!options.captureDir.empty()) {
+            ExportImage(frame, TextFormat("%s/frame_%05d.png", options.captureDir.c_str(), captureFrameIndex));
         }
-        else if (gameState == PLAYING) {
-            drawGame();
-        }
-        else if (gameState == GAME_OVER || gameState == GAME_WON) {
-            drawGame();
-            drawEndScreen();
+        if (captureRaw) {
+            std::fwrite(frame.data, 1, static_cast<size_t>(frame.width) * static_cast<size_t>(frame.height) * 4,
+                captureRaw);
         }
 
-        EndDrawing();
+        UnloadImage(frame);
+        captureFrameIndex++;
+        captureMs = millisecondsSince(start);
     }
 
-    void drawParticles() {
-        for (const auto& particle : particles) {
-            DrawCircleV(particle.position, particle.size, Fade(particle.color, particle.life));
+    void drawParticles(const RenderSnapshot& view) {
+        TraceScope scope("drawParticles");
+        for (const auto& particle : view.particles) {
+            drawDisc(particle.position, particle.size, Fade(particle.color, particle.life));
         }
     }
 
-    void drawMainMenu() {
+    void drawMenuBackground() {
         if (menuBackgroundTexture.id != 0) {
             DrawTexturePro(menuBackgroundTexture,
                 { 0, 0, (float)menuBackgroundTexture.width, (float)menuBackgroundTexture.height },
@@ -1379,8 +648,13 @@ public:
                 { 0, 0 }, 0.0f, WHITE);
         }
         else {
-            DrawText("BubbleBlast", screenWidth / 2 - MeasureText("BubbleBlast", 50) / 2, 150, 50, WHITE);
+            text.drawCentered(titleText, screenWidth / 2, 150, WHITE);
         }
+    }
+
+    void drawMainMenu() {
+        TraceScope scope("drawMainMenu");
+        drawLayer(menuLayer, 0, [this]() { drawMenuBackground(); });
 
         Color startTint = WHITE;
         if (CheckCollisionPointRec(GetMousePosition(), startButtonRect)) {
@@ -1396,10 +670,8 @@ public:
         else {
             DrawRectangleRec(startButtonRect, LIGHTGRAY);
             DrawRectangleLinesEx(startButtonRect, 2, DARKGRAY);
-            DrawText("Start Game",
-                startButtonRect.x + startButtonRect.width / 2 - MeasureText("Start Game", 20) / 2,
-                startButtonRect.y + startButtonRect.height / 2 - 10,
-                20, DARKBLUE);
+            text.drawCentered(startText, static_cast<int>(startButtonRect.x + startButtonRect.width / 2),
+                static_cast<int>(startButtonRect.y + startButtonRect.height / 2 - 10), DARKBLUE);
         }
 
         Color levelsTint = WHITE;
@@ -1416,10 +688,8 @@ public:
         else {
             DrawRectangleRec(levelsButtonRect, LIGHTGRAY);
             DrawRectangleLinesEx(levelsButtonRect, 2, DARKGRAY);
-            DrawText("Levels",
-                levelsButtonRect.x + levelsButtonRect.width / 2 - MeasureText("Levels", 20) / 2,
-                levelsButtonRect.y + levelsButtonRect.height / 2 - 10,
-                20, DARKBLUE);
+            text.drawCentered(levelsText, static_cast<int>(levelsButtonRect.x + levelsButtonRect.width / 2),
+                static_cast<int>(levelsButtonRect.y + levelsButtonRect.height / 2 - 10), DARKBLUE);
         }
 
         Color exitTint = WHITE;
@@ -1436,17 +706,17 @@ public:
         else {
             DrawRectangleRec(exitButtonRect, LIGHTGRAY);
             DrawRectangleLinesEx(exitButtonRect, 2, DARKGRAY);
-            DrawText("Exit",
-                exitButtonRect.x + exitButtonRect.width / 2 - MeasureText("Exit", 20) / 2,
-                exitButtonRect.y + exitButtonRect.height / 2 - 10,
-                20, DARKBLUE);
+            text.drawCentered(exitText, static_cast<int>(exitButtonRect.x + exitButtonRect.width / 2),
+                static_cast<int>(exitButtonRect.y + exitButtonRect.height / 2 - 10), DARKBLUE);
         }
     }
 
-    void drawLevelSelect() {
-        DrawRectangleGradientV(0, 0, screenWidth, screenHeight, DARKPURPLE, GRAY);
-
-        DrawText("SELECT LEVEL", screenWidth / 2 - MeasureText("SELECT LEVEL", 40) / 2, 30, 40, WHITE);
+    void drawLevelSelect(const RenderSnapshot& view) {
+        TraceScope scope("drawLevelSelect");
+        drawLayer(levelSelectLayer, 0, [this]() {
+            DrawRectangleGradientV(0, 0, screenWidth, screenHeight, DARKPURPLE, GRAY);
+            text.drawCentered(selectLevelText, screenWidth / 2, 30, WHITE);
+        });
 
         float buttonSize = 60.0f;
         float buttonMargin = 20.0f;
@@ -1483,9 +753,7 @@ public:
         int levelButtonHeight = 70;
         int startY = 100;
 
-        for (size_t i = 0; i < levels.size(); i++) {
-            const Level& level = levels[i];
-
+        for (size_t i = 0; i < sim.getLevels().size(); i++) {
             Color buttonColor;
             if (i % 5 == 0) buttonColor = BLUE;
             else if (i % 5 == 1) buttonColor = DARKGREEN;
@@ -1493,7 +761,7 @@ public:
             else if (i % 5 == 3) buttonColor = MAGENTA;
             else buttonColor = RED;
 
-            if (currentLevel == static_cast<int>(i) + 1) {
+            if (view.currentLevel == static_cast<int>(i) + 1) {
                 buttonColor = Fade(buttonColor, 0.7f);
             }
 
@@ -1508,35 +776,31 @@ public:
             DrawRectangleRec(levelRect, buttonColor);
             DrawRectangleLinesEx(levelRect, 2, WHITE);
 
-            std::string levelText = "Level " + std::to_string(level.levelNumber) + ": " + level.name;
-            DrawText(levelText.c_str(),
+            text.draw(levelNameTexts[i],
                 static_cast<int>(levelRect.x + 20),
                 static_cast<int>(levelRect.y + 10),
-                22, WHITE);
+                WHITE);
 
-            std::string scoreText = "Target: " + std::to_string(level.targetScore) + " points";
-            DrawText(scoreText.c_str(),
+            text.draw(levelTargetTexts[i],
                 static_cast<int>(levelRect.x + 20),
                 static_cast<int>(levelRect.y + 35),
-                16, LIGHTGRAY);
+                LIGHTGRAY);
 
-            std::string difficulty = "";
-            if (i == 0) difficulty = "★☆☆☆☆";
-            else if (i == 1) difficulty = "★★☆☆☆";
-            else if (i == 2) difficulty = "★★★☆☆";
-            else if (i == 3) difficulty = "★★★★☆";
-            else difficulty = "★★★★★";
-
-            DrawText(difficulty.c_str(),
+            text.draw(levelDifficultyTexts[i],
                 static_cast<int>(levelRect.x + levelRect.width - 70),
                 static_cast<int>(levelRect.y + 25),
-                20, YELLOW);
+                YELLOW);
         }
     }
 
-    void drawGame() {
-        if (isLevelMode && currentLevel >= 1 && currentLevel <= static_cast<int>(levels.size())) {
-            Level& level = levels[static_cast<size_t>(currentLevel) - 1];
+    bool hasLevelBackdrop(const RenderSnapshot& view) const {
+        return view.isLevelMode && view.currentLevel >= 1 && view.currentLevel <= static_cast<int>(sim.getLevels().size());
+    }
+
+    void drawBackdrop(const RenderSnapshot& view) {
+        TraceScope scope("drawBackdrop");
+        if (hasLevelBackdrop(view)) {
+            const Level& level = sim.getLevels()[static_cast<size_t>(view.currentLevel) - 1];
             DrawRectangle(0, 0, screenWidth, screenHeight, level.backgroundColor);
         }
         else if (gameBackgroundTexture.id != 0) {
@@ -1548,9 +812,10 @@ public:
         else {
             ClearBackground(BLACK);
         }
+    }
 
-        drawParticles();
-
+    void drawFrame() {
+        TraceScope scope("drawFrame");
         DrawRectangle(0, screenHeight - 50, screenWidth, 50, Fade(DARKGRAY, 0.7f));
         DrawRectangle(0, 0, screenWidth, 60, Fade(DARKGRAY, 0.7f));
 
@@ -1562,119 +827,118 @@ public:
         DrawCircleLines(static_cast<int>(newBallPosition.x), static_cast<int>(newBallPosition.y),
             static_cast<int>(ballRadius), Fade(GREEN, 0.3f));
 
-        drawMinimalConnections();
+        text.draw(helpText, 20, screenHeight - 30, LIGHTGRAY);
+    }
+
+    void drawGame(const RenderSnapshot& view) {
+        TraceScope scope("drawGame");
+        // Particles sit between the backdrop and the frame. Without any, the
+        // two are blitted as one pre-composited layer.
+        int backdropKey = hasLevelBackdrop(view) ? view.currentLevel : 0;
+        if (view.particles.empty()) {
+            drawLayer(compositeLayer, backdropKey, [&]() {
+                drawBackdrop(view);
+                drawFrame();
+            });
+        }
+        else {
+            drawLayer(backdropLayer, backdropKey, [&]() { drawBackdrop(view); });
+            drawParticles(view);
+            drawLayer(frameLayer, 0, [this]() { drawFrame(); });
+        }
 
-        for (const auto& ball : balls) {
-            if (ball.active) {
-                DrawCircleV(ball.position, ball.radius, ball.color);
+        const QualitySettings& settings = quality.settings();
+        if (settings.connections) {
+            drawMinimalConnections(view);
+        }
 
-                if (ball.type == UNIVERSAL && universalIconTexture.id != 0) {
-                    Rectangle dest = { ball.position.x - ball.radius, ball.position.y - ball.radius,
-                                     ball.radius * 2, ball.radius * 2 };
-                    DrawTexturePro(universalIconTexture,
-                        { 0, 0, (float)universalIconTexture.width, (float)universalIconTexture.height },
-                        dest,
-                        { 0, 0 }, 0.0f, WHITE);
-                }
-                else if (ball.type == BOMB && bombIconTexture.id != 0) {
-                    Rectangle dest = { ball.position.x - ball.radius, ball.position.y - ball.radius,
-                                     ball.radius * 2, ball.radius * 2 };
-                    DrawTexturePro(bombIconTexture,
-                        { 0, 0, (float)bombIconTexture.width, (float)bombIconTexture.height },
-                        dest,
-                        { 0, 0 }, 0.0f, WHITE);
-                }
-                else if (ball.type == RAINBOW && rainbowIconTexture.id != 0) {
-                    Rectangle dest = { ball.position.x - ball.radius, ball.position.y - ball.radius,
-                                     ball.radius * 2, ball.radius * 2 };
-                    DrawTexturePro(rainbowIconTexture,
-                        { 0, 0, (float)rainbowIconTexture.width, (float)rainbowIconTexture.height },
-                        dest,
-                        { 0, 0 }, 0.0f, WHITE);
-                }
+        TraceScope ballScope("drawBalls");
+        for (const auto& ball : view.balls) {
+            drawDisc(ball.position, ball.radius, ball.color);
 
-                DrawCircleLines(static_cast<int>(ball.position.x), static_cast<int>(ball.position.y),
-                    static_cast<int>(ball.radius), Fade(WHITE, 0.3f));
+            drawBallIcon(ball.type, ball.position, ball.radius);
 
-                if (ball.type == BOMB) {
-                    DrawCircleLines(static_cast<int>(ball.position.x), static_cast<int>(ball.position.y),
-                        static_cast<float>(ball.bombRadius), Fade(RED, 0.2f));
-                }
-            }
-        }
+            if (!settings.outlines) continue;
 
-        if (currentBall) {
-            DrawCircleV(currentBall->position, ballRadius, currentBall->color);
+            drawRing(ball.position, ball.radius, Fade(WHITE, 0.3f));
 
-            if (currentBall->type == UNIVERSAL && universalIconTexture.id != 0) {
-                Rectangle dest = { currentBall->position.x - ballRadius, currentBall->position.y - ballRadius,
-                                 ballRadius * 2, ballRadius * 2 };
-                DrawTexturePro(universalIconTexture,
-                    { 0, 0, (float)universalIconTexture.width, (float)universalIconTexture.height },
-                    dest,
-                    { 0, 0 }, 0.0f, WHITE);
+            if (traitsOf(ball.type).showsBlastRadius) {
+                drawRing(ball.position, static_cast<float>(ball.bombRadius), Fade(RED, 0.2f));
             }
-            else if (currentBall->type == BOMB && bombIconTexture.id != 0) {
-                Rectangle dest = { currentBall->position.x - ballRadius, currentBall->position.y - ballRadius,
-                                 ballRadius * 2, ballRadius * 2 };
-                DrawTexturePro(bombIconTexture,
-                    { 0, 0, (float)bombIconTexture.width, (float)bombIconTexture.height },
-                    dest,
-                    { 0, 0 }, 0.0f, WHITE);
-            }
-            else if (currentBall->type == RAINBOW && rainbowIconTexture.id != 0) {
-                Rectangle dest = { currentBall->position.x - ballRadius, currentBall->position.y - ballRadius,
-                                 ballRadius * 2, ballRadius * 2 };
-                DrawTexturePro(rainbowIconTexture,
-                    { 0, 0, (float)rainbowIconTexture.width, (float)rainbowIconTexture.height },
-                    dest,
-                    { 0, 0 }, 0.0f, WHITE);
+        }
+
+        if (view.hasCurrentBall) {
+            Vector2 ballPosition = view.currentBall.position;
+            Vector2 aimDirection = view.aimDirection;
+            if (view.isAiming && options.lowLatencyInput) {
+                latchAim(ballPosition, aimDirection);
             }
 
-            DrawCircleLines(static_cast<int>(currentBall->position.x), static_cast<int>(currentBall->position.y),
+            DrawCircleV(ballPosition, ballRadius, view.currentBall.color);
+
+            drawBallIcon(view.currentBall.type, ballPosition, ballRadius);
+
+            DrawCircleLines(static_cast<int>(ballPosition.x), static_cast<int>(ballPosition.y),
                 static_cast<int>(ballRadius), YELLOW);
 
-            if (isAiming) {
+            if (view.isAiming) {
                 Vector2 endPoint = {
-                    currentBall->position.x + aimDirection.x * 200.0f,
-                    currentBall->position.y + aimDirection.y * 200.0f
+                    ballPosition.x + aimDirection.x * 200.0f,
+                    ballPosition.y + aimDirection.y * 200.0f
                 };
-                DrawLineV(currentBall->position, endPoint, Fade(YELLOW, 0.7f));
+                DrawLineV(ballPosition, endPoint, Fade(YELLOW, 0.7f));
                 DrawCircleV(endPoint, 3.0f, RED);
 
                 float power = sqrtf(
-                    (currentBall->position.x - newBallPosition.x) * (currentBall->position.x - newBallPosition.x) +
-                    (currentBall->position.y - newBallPosition.y) * (currentBall->position.y - newBallPosition.y)
+                    (ballPosition.x - newBallPosition.x) * (ballPosition.x - newBallPosition.x) +
+                    (ballPosition.y - newBallPosition.y) * (ballPosition.y - newBallPosition.y)
                 ) / 50.0f;
 
                 if (power > 1.5f) power = 1.5f;
-                DrawText(TextFormat("Power: %.1f", power),
-                    static_cast<int>(currentBall->position.x - 30.0f),
-                    static_cast<int>(currentBall->position.y - 40.0f),
-                    12, WHITE);
+                int tenths = static_cast<int>(lrintf(power * 10.0f));
+                text.update(powerText, static_cast<uint64_t>(tenths), "Power: %.1f", tenths / 10.0);
+                text.draw(powerText,
+                    static_cast<int>(ballPosition.x - 30.0f),
+                    static_cast<int>(ballPosition.y - 40.0f),
+                    WHITE);
             }
         }
 
-        if (isLevelMode && currentLevel >= 1 && currentLevel <= static_cast<int>(levels.size())) {
-            Level& level = levels[static_cast<size_t>(currentLevel) - 1];
+        if (view.isLevelMode && view.currentLevel >= 1 && view.currentLevel <= static_cast<int>(sim.getLevels().size())) {
+            const Level& level = sim.getLevels()[static_cast<size_t>(view.currentLevel) - 1];
 
-            DrawText(TextFormat("Level: %d - %s", level.levelNumber, level.name.c_str()), 20, 10, 20, WHITE);
-            DrawText(TextFormat("Score: %d / %d", score, level.targetScore), 20, 35, 20, WHITE);
+            text.update(levelTitleText, static_cast<uint64_t>(view.currentLevel),
+                "Level: %d - %s", level.levelNumber, level.name);
+            text.update(levelScoreText, textKey(view.score, level.targetScore),
+                "Score: %d / %d", view.score, level.targetScore);
+            text.draw(levelTitleText, 20, 10, WHITE);
+            text.draw(levelScoreText, 20, 35, WHITE);
         }
         else {
-            DrawText(TextFormat("Score: %d", score), 20, 10, 20, WHITE);
-            DrawText("Endless Mode", 20, 35, 20, WHITE);
+            text.update(endlessScoreText, static_cast<uint64_t>(view.score), "Score: %d", view.score);
+            text.draw(endlessScoreText, 20, 10, WHITE);
+            text.draw(endlessModeText, 20, 35, WHITE);
         }
 
-        DrawText(TextFormat("Balls: %zu", balls.size()), screenWidth - 120, 20, 20, WHITE);
+        text.update(ballCountText, view.balls.size(), "Balls: %zu", view.balls.size());
+        text.draw(ballCountText, screenWidth - 120, 20, WHITE);
+
+        int slot = 0;
+        for (size_t i = 0; i < view.colorCounts.size(); i++) {
+            if (view.colorCounts[i] == 0) continue;
 
-        DrawText("LMB - shoot, R - restart, M - menu", 20, screenHeight - 30, 15, LIGHTGRAY);
+            int x = screenWidth - 225 + slot * 22;
+            DrawCircle(x, 50, 4.0f, ballPalette[i]);
+            text.update(colorCountTexts[i], view.colorCounts[i], "%d", view.colorCounts[i]);
+            text.draw(colorCountTexts[i], x + 6, 45, LIGHTGRAY);
+            slot++;
+        }
 
-        if (isLevelMode && currentLevel >= 1 && currentLevel <= static_cast<int>(levels.size())) {
-            Level& level = levels[static_cast<size_t>(currentLevel) - 1];
+        if (view.isLevelMode && view.currentLevel >= 1 && view.currentLevel <= static_cast<int>(sim.getLevels().size())) {
+            const Level& level = sim.getLevels()[static_cast<size_t>(view.currentLevel) - 1];
 
             float progressWidth = 300.0f;
-            float progress = static_cast<float>(score) / static_cast<float>(level.targetScore);
+            float progress = static_cast<float>(view.score) / static_cast<float>(level.targetScore);
             if (progress > 1.0f) progress = 1.0f;
 
             DrawRectangle(screenWidth / 2 - 150, screenHeight - 40,
@@ -1684,104 +948,571 @@ public:
             DrawRectangleLines(screenWidth / 2 - 150, screenHeight - 40,
                 static_cast<int>(progressWidth), 20, WHITE);
 
-            std::string progressText = std::to_string(score) + " / " + std::to_string(level.targetScore);
-            DrawText(progressText.c_str(),
-                screenWidth / 2 - MeasureText(progressText.c_str(), 15) / 2,
-                screenHeight - 38,
-                15, WHITE);
+            text.update(progressText, textKey(view.score, level.targetScore), "%d / %d", view.score, level.targetScore);
+            text.drawCentered(progressText, screenWidth / 2, screenHeight - 38, WHITE);
         }
     }
 
-    void drawEndScreen() {
+    void drawEndScreen(const RenderSnapshot& view) {
+        TraceScope scope("drawEndScreen");
         DrawRectangle(0, 0, screenWidth, screenHeight, Fade(BLACK, 0.8f));
 
-        if (gameState == GAME_OVER) {
-            DrawText("GAME OVER!", screenWidth / 2 - 100, screenHeight / 2 - 60, 30, RED);
-            DrawText(TextFormat("Final Score: %d", score), screenWidth / 2 - 90, screenHeight / 2 - 10, 25, WHITE);
-            DrawText("Press R to restart", screenWidth / 2 - 100, screenHeight / 2 + 80, 20, GREEN);
+        text.update(finalScoreText, static_cast<uint64_t>(view.score), "Final Score: %d", view.score);
+
+        if (view.gameState == GAME_OVER) {
+            text.draw(gameOverText, screenWidth / 2 - 100, screenHeight / 2 - 60, RED);
+            text.draw(finalScoreText, screenWidth / 2 - 90, screenHeight / 2 - 10, WHITE);
+            text.draw(restartHintText, screenWidth / 2 - 100, screenHeight / 2 + 80, GREEN);
         }
-        else if (gameState == GAME_WON) {
-            DrawText("YOU WIN!", screenWidth / 2 - 80, screenHeight / 2 - 60, 40, GREEN);
-            DrawText(TextFormat("Final Score: %d", score), screenWidth / 2 - 90, screenHeight / 2, 25, WHITE);
+        else if (view.gameState == GAME_WON) {
+            text.draw(youWinText, screenWidth / 2 - 80, screenHeight / 2 - 60, GREEN);
+            text.draw(finalScoreText, screenWidth / 2 - 90, screenHeight / 2, WHITE);
 
-            if (isLevelMode && currentLevel >= static_cast<int>(levels.size())) {
-                DrawText("All levels completed!", screenWidth / 2 - 120, screenHeight / 2 + 40, 25, YELLOW);
+            if (view.isLevelMode && view.currentLevel >= static_cast<int>(sim.getLevels().size())) {
+                text.draw(allLevelsText, screenWidth / 2 - 120, screenHeight / 2 + 40, YELLOW);
             }
-            else if (isLevelMode) {
-                DrawText(TextFormat("Next level: %d", currentLevel + 1),
-                    screenWidth / 2 - 100, screenHeight / 2 + 40, 25, YELLOW);
+            else if (view.isLevelMode) {
+                text.update(nextLevelText, static_cast<uint64_t>(view.currentLevel), "Next level: %d", view.currentLevel + 1);
+                text.draw(nextLevelText, screenWidth / 2 - 100, screenHeight / 2 + 40, YELLOW);
             }
 
-            DrawText("Press R to continue", screenWidth / 2 - 110, screenHeight / 2 + 80, 20, GREEN);
+            text.draw(continueHintText, screenWidth / 2 - 110, screenHeight / 2 + 80, GREEN);
         }
 
-        DrawText("Press M for Main Menu", screenWidth / 2 - 120, screenHeight / 2 + 120, 20, SKYBLUE);
+        text.draw(menuHintText, screenWidth / 2 - 120, screenHeight / 2 + 120, SKYBLUE);
     }
 
-    void drawMinimalConnections() {
-        for (size_t i = 0; i < balls.size(); i++) {
-            if (!balls[i].active || !balls[i].isStuck) continue;
+    void drawMinimalConnections(const RenderSnapshot& view) {
+        TraceScope scope("drawMinimalConnections");
+        const auto& viewBalls = view.balls;
 
-            for (size_t j = i + 1; j < balls.size(); j++) {
-                if (!balls[j].active || !balls[j].isStuck) continue;
+        for (size_t i = 0; i < viewBalls.size(); i++) {
+            if (!viewBalls[i].isStuck) continue;
 
-                float dx = balls[j].position.x - balls[i].position.x;
-                float dy = balls[j].position.y - balls[i].position.y;
+            for (size_t j = i + 1; j < viewBalls.size(); j++) {
+                if (!viewBalls[j].isStuck) continue;
+
+                float dx = viewBalls[j].position.x - viewBalls[i].position.x;
+                float dy = viewBalls[j].position.y - viewBalls[i].position.y;
                 float distance = sqrtf(dx * dx + dy * dy);
 
                 if (distance < ballRadius * 2.1f) {
                     float alpha = 1.0f - (distance / (ballRadius * 2.1f));
-                    DrawLineV(balls[i].position, balls[j].position, Fade(WHITE, alpha * 0.2f));
+                    DrawLineV(viewBalls[i].position, viewBalls[j].position, Fade(WHITE, alpha * 0.2f));
                 }
             }
         }
     }
 
-    void run() {
-        while (!WindowShouldClose()) {
-            if (IsKeyPressed(KEY_R)) {
-                restart();
+    void drawDebugOverlay(const RenderSnapshot& view) {
+        TraceScope scope("drawDebugOverlay");
+        int lines = allocTracker.enabled ? 6 + TAG_COUNT : 6;
+        DrawRectangle(screenWidth - 230, 62, 220, 12 + lines * 14, Fade(BLACK, 0.6f));
+        if (allocTracker.enabled) {
+            DrawText(TextFormat("Heap allocs/frame: %llu", static_cast<unsigned long long>(allocationsLastFrame)),
+                screenWidth - 224, 68, 12, allocationsLastFrame == 0 ? GREEN : ORANGE);
+        }
+        else {
+            DrawText("Heap allocs/frame: off", screenWidth - 224, 68, 12, LIGHTGRAY);
+        }
+        DrawText(TextFormat("Rewind: %.1f KB", static_cast<double>(view.rewindBytes) / 1024.0),
+            screenWidth - 224, 82, 12, LIGHTGRAY);
+        DrawText(TextFormat("Events/frame: %d", eventsLastFrame),
+            screenWidth - 224, 96, 12, LIGHTGRAY);
+        LatencySummary latency = inputLatency.summary();
+        DrawText(TextFormat("Input p50/p99: %.2f / %.2f ms", latency.p50Ms, latency.p99Ms),
+            screenWidth - 224, 110, 12, LIGHTGRAY);
+        FrameStats frames = pacer.stats();
+        DrawText(TextFormat("Frame: %.2f ms, sd %.2f, %u late", frames.meanMs, frames.stddevMs, frames.missed),
+            screenWidth - 224, 124, 12, LIGHTGRAY);
+        DrawText(TextFormat("Quality: %s, %.2f / %.2f ms", qualityName(quality.getLevel()), quality.getAverageMs(),
+            quality.getBudgetMs()), screenWidth - 224, 138, 12, LIGHTGRAY);
+
+        if (!allocTracker.enabled) return;
+
+        for (int i = 0; i < TAG_COUNT; i++) {
+            const AllocStats& entry = allocTracker.get(static_cast<AllocTag>(i));
+            DrawText(TextFormat("%-9s %4lld live %7.1f KB",
+                AllocTracker::tagName(static_cast<AllocTag>(i)),
+                static_cast<long long>(entry.liveAllocations.load(std::memory_order_relaxed)),
+                static_cast<double>(entry.liveBytes.load(std::memory_order_relaxed)) / 1024.0),
+                screenWidth - 224, 152 + i * 14, 12, LIGHTGRAY);
+        }
+    }
+
+    static bool moved(Vector2 a, Vector2 b) {
+        return fabsf(a.x - b.x) > 0.25f || fabsf(a.y - b.y) > 0.25f;
+    }
+
+    static bool sameBall(const BallView& a, const BallView& b) {
+        return !moved(a.position, b.position) && a.radius == b.radius && a.type == b.type &&
+            a.isStuck == b.isStuck && a.color.r == b.color.r && a.color.g == b.color.g &&
+            a.color.b == b.color.b && a.color.a == b.color.a;
+    }
+
+    // Sub-quarter-pixel jitter of a settled board does not count as a change.
+    bool viewChanged(const RenderSnapshot& view) const {
+        if (!view.particles.empty() || !lastDrawn.particles.empty()) return true;
+        if (view.gameState != lastDrawn.gameState || view.score != lastDrawn.score ||
+            view.currentLevel != lastDrawn.currentLevel || view.isLevelMode != lastDrawn.isLevelMode) {
+            return true;
+        }
+        if (view.hasCurrentBall != lastDrawn.hasCurrentBall || view.isAiming != lastDrawn.isAiming ||
+            moved(view.aimDirection, lastDrawn.aimDirection)) {
+            return true;
+        }
+        if (view.hasCurrentBall && !sameBall(view.currentBall, lastDrawn.currentBall)) return true;
+        if (view.balls.size() != lastDrawn.balls.size()) return true;
+
+        for (size_t i = 0; i < view.balls.size(); i++) {
+            if (!sameBall(view.balls[i], lastDrawn.balls[i])) return true;
+        }
+        return false;
+    }
+
+    bool isInputActive(const InputState& sample) const {
+        return moved(sample.mousePosition, lastMousePosition) || sample.command != COMMAND_NONE ||
+            sample.mouseLeftPressed || sample.restartPressed || sample.menuPressed || sample.escapePressed ||
+            sample.saveStatePressed || sample.loadStatePressed || sample.undoShotPressed || sample.rewindPressed;
+    }
+
+    // The paced frame rate, or 60 Hz when frames are uncapped.
+    double displayRate() const {
+        return pacer.isCapped() ? pacer.getRate() : 60.0;
+    }
+
+    // Draws the frame. In power-save mode an unchanged frame is skipped
+    // instead: input is still polled, first at the display rate and then
+    // at idlePollRate. Returns how many display frames the wait covered.
+    int present(const RenderSnapshot& view, bool inputActive) {
+        if (!options.powerSave || inputActive || showDebugOverlay || !hasLastDrawn || viewChanged(view)) {
+            draw(view);
+            if (options.powerSave) {
+                lastDrawn.balls.assign(view.balls.begin(), view.balls.end());
+                lastDrawn.particles.assign(view.particles.begin(), view.particles.end());
+                lastDrawn.currentBall = view.currentBall;
+                lastDrawn.hasCurrentBall = view.hasCurrentBall;
+                lastDrawn.isAiming = view.isAiming;
+                lastDrawn.aimDirection = view.aimDirection;
+                lastDrawn.score = view.score;
+                lastDrawn.gameState = view.gameState;
+                lastDrawn.currentLevel = view.currentLevel;
+                lastDrawn.isLevelMode = view.isLevelMode;
+                hasLastDrawn = true;
+            }
+            idleFrames = 0;
+            return 1;
+        }
+
+        idleFrames++;
+        double rate = displayRate();
+        int frames = idleFrames > idleFramesBeforeSlowdown ? std::max(1, static_cast<int>(rate / idlePollRate)) : 1;
+        WaitTime(frames / rate);
+        PollInputEvents();
+        return frames;
+    }
+
+    // A session spans one stretch of PLAYING; the simulation time is whatever
+    // the ticks since the previous frame took, on either thread. The frame
+    // time is measured by the loop, since power-save idle frames never reach
+    // EndDrawing() and raylib's own frame time would go stale.
+    void recordTelemetry(const RenderSnapshot& view, float frameSeconds) {
+        if (!telemetry.isOpen()) return;
+
+        if (view.gameState == PLAYING && !telemetry.isInSession()) {
+            telemetry.beginSession(view.currentLevel, view.isLevelMode, options.sim.seed);
+        }
+        else if (view.gameState != PLAYING && telemetry.isInSession()) {
+            telemetry.endSession(view.score);
+        }
+
+        phaseMs[PHASE_SIM] = static_cast<float>(simNanoseconds.exchange(0, std::memory_order_relaxed)) / 1.0e6f;
+        telemetry.frame(frameSeconds, phaseMs, view.balls.size(), view.particles.size(), view.score,
+            quality.getLevel());
+    }
+
+    void beginFrame() {
+        uint64_t count = heapAllocationCount;
+        allocationsLastFrame = count - frameAllocationMark;
+        frameAllocationMark = count;
+        consumeEvents();
+
+        if (IsKeyPressed(KEY_F3) || lateDebugToggle) {
+            showDebugOverlay = !showDebugOverlay;
+        }
+        lateDebugToggle = false;
+    }
+
+    InputState sampleInput() const {
+        InputState sample{};
+        sample.mousePosition = GetMousePosition();
+        sample.mouseLeftPressed = IsMouseButtonPressed(MOUSE_LEFT_BUTTON);
+        sample.restartPressed = IsKeyPressed(KEY_R);
+        sample.menuPressed = IsKeyPressed(KEY_M);
+        sample.escapePressed = IsKeyPressed(KEY_ESCAPE);
+        sample.saveStatePressed = IsKeyPressed(KEY_F5);
+        sample.loadStatePressed = IsKeyPressed(KEY_F9);
+        sample.undoShotPressed = IsKeyPressed(KEY_Z);
+        sample.rewindPressed = IsKeyPressed(KEY_F7);
+        return sample;
+    }
+
+    // Gives each mouse move or click a serial the snapshot will echo back,
+    // so the frame that first shows it can be found.
+    void stampInput(InputState& sample) {
+        if (sample.mouseLeftPressed || moved(sample.mousePosition, stampedMousePosition)) {
+            inputSerial++;
+            inputLatency.sampled(inputSerial, sample.mouseLeftPressed, Clock::now());
+            stampedMousePosition = sample.mousePosition;
+        }
+        sample.serial = inputSerial;
+    }
+
+    // Samples input at the top of a frame, folding in any edges the aim
+    // latch caught during the previous draw.
+    InputState pollInput() {
+        InputState sample = sampleInput();
+        stampInput(sample);
+        mergeInput(lateInput, sample);
+        sample = lateInput;
+        clearInputEdges(lateInput);
+        return sample;
+    }
+
+    // Low-latency mode: polls again right before the aim is drawn and takes
+    // the step the next tick will take towards the fresh mouse position, so
+    // the aim line and the ball follow the newest sample instead of the one
+    // taken before the tick. Presses seen here go into the next frame's
+    // input rather than being lost to the poll in EndDrawing().
+    void latchAim(Vector2& position, Vector2& direction) {
+        PollInputEvents();
+        InputState late = sampleInput();
+        stampInput(late);
+        latchedSerial = late.serial;
+        lateDebugToggle = lateDebugToggle || IsKeyPressed(KEY_F3);
+        mergeInput(lateInput, late);
+
+        Vector2 target = BubbleSim::aimTarget(late.mousePosition);
+        position.x += (target.x - position.x) * BubbleSim::aimSmoothing;
+        position.y += (target.y - position.y) * BubbleSim::aimSmoothing;
+        direction = BubbleSim::aimDirectionFrom(position);
+    }
+
+    // Reads the play area of the back buffer, flushing queued draws first.
+    std::vector<Color> capturePlayArea() {
+        rlDrawRenderBatchActive();
+        Image screen = LoadImageFromScreen();
+        const Color* pixels = static_cast<const Color*>(screen.data);
+
+        int left = static_cast<int>(gameAreaLeft);
+        int top = static_cast<int>(gameAreaTop);
+        int right = std::min(screen.width, left + static_cast<int>(gameAreaWidth));
+        int bottom = std::min(screen.height, top + static_cast<int>(gameAreaHeight));
+
+        std::vector<Color> area;
+        for (int y = top; y < bottom; y++) {
+            for (int x = left; x < right; x++) {
+                area.push_back(pixels[static_cast<size_t>(y) * static_cast<size_t>(screen.width) + x]);
             }
+        }
+        UnloadImage(screen);
+        return area;
+    }
 
-            if (IsKeyPressed(KEY_M)) {
-                if (gameState == GAME_OVER || gameState == GAME_WON || gameState == PLAYING) {
-                    gameState = MAIN_MENU;
-                    restart();
-                }
+    // Draws the backdrop and frame once through the composite layer and once
+    // directly, each over a cleared screen of a colour the scene never uses,
+    // and counts play-area pixels that differ. Anything the layer lets
+    // through from underneath shows up as a mismatch.
+    size_t countLayerMismatches(const RenderSnapshot& view) {
+        int backdropKey = hasLevelBackdrop(view) ? view.currentLevel : 0;
+        compositeLayer.invalidate();
+
+        BeginDrawing();
+        ClearBackground(MAGENTA);
+        drawLayer(compositeLayer, backdropKey, [&]() {
+            drawBackdrop(view);
+            drawFrame();
+        });
+        std::vector<Color> blitted = capturePlayArea();
+
+        ClearBackground(MAGENTA);
+        drawBackdrop(view);
+        drawFrame();
+        std::vector<Color> direct = capturePlayArea();
+        EndDrawing();
+
+        size_t mismatches = 0;
+        for (size_t i = 0; i < blitted.size(); i++) {
+            const Color& a = blitted[i];
+            const Color& b = direct[i];
+            if (std::abs(a.r - b.r) > 1 || std::abs(a.g - b.g) > 1 || std::abs(a.b - b.b) > 1) {
+                mismatches++;
+            }
+        }
+        return mismatches;
+    }
+
+    // Plays a scripted bot session one tick per frame and times each draw().
+    // Nothing needs a display or a GPU: under Xvfb with Mesa's software
+    // driver (LIBGL_ALWAYS_SOFTWARE=1) the hidden window renders on the CPU.
+    // Capture time is left out of the per-frame cost.
+    void runRenderBench() {
+        BotSession bot(options.renderBenchLevel, options.sim.seed ? options.sim.seed : 1);
+        if (!options.captureRawPath.empty()) {
+            captureRaw = std::fopen(options.captureRawPath.c_str(), "wb");
+            if (!captureRaw) {
+                std::printf("cannot open %s\n", options.captureRawPath.c_str());
+                return;
             }
+        }
 
-            if (IsKeyPressed(KEY_ESCAPE)) {
-                if (gameState == PLAYING) {
-                    gameState = MAIN_MENU;
-                    restart();
-                }
-                else if (gameState == LEVEL_SELECT) {
-                    gameState = MAIN_MENU;
+        std::vector<double> drawTimes;
+        drawTimes.reserve(static_cast<size_t>(options.renderBenchFrames));
+        size_t peakBalls = 0;
+        size_t peakParticles = 0;
+        frameDelta = 1.0f / 60.0f;
+
+        for (int frame = 0; frame < options.renderBenchFrames && !WindowShouldClose(); frame++) {
+            beginFrame();
+            input = bot.next(sim);
+            tick();
+
+            const RenderSnapshot& view = snapshots.read();
+            peakBalls = std::max(peakBalls, view.balls.size());
+            peakParticles = std::max(peakParticles, view.particles.size());
+
+            captureMs = 0.0f;
+            Clock::time_point start = Clock::now();
+            draw(view);
+            drawTimes.push_back(millisecondsSince(start) - captureMs);
+        }
+
+        if (captureRaw) {
+            std::fclose(captureRaw);
+            captureRaw = nullptr;
+        }
+        if (drawTimes.empty()) return;
+
+        double total = 0.0;
+        for (double time : drawTimes) {
+            total += time;
+        }
+        std::sort(drawTimes.begin(), drawTimes.end());
+
+        std::printf("render bench: %zu frames, level %d, %dx%d, quality %s\n", drawTimes.size(),
+            options.renderBenchLevel, screenWidth, screenHeight, qualityName(quality.getLevel()));
+        std::printf("%10s %10s %10s %10s %8s %10s\n", "mean ms", "p50 ms", "p99 ms", "max ms", "balls", "particles");
+        std::printf("%10.3f %10.3f %10.3f %10.3f %8zu %10zu\n", total / drawTimes.size(),
+            drawTimes[drawTimes.size() / 2], drawTimes[drawTimes.size() * 99 / 100], drawTimes.back(),
+            peakBalls, peakParticles);
+
+        size_t mismatches = countLayerMismatches(snapshots.read());
+        std::printf("layer blit: %s (%zu play-area pixels differ from a direct draw)\n",
+            mismatches == 0 ? "ok" : "MISMATCH", mismatches);
+    }
+
+    void run() {
+        if (options.renderBenchFrames > 0) {
+            runRenderBench();
+            return;
+        }
+
+        if (options.threadedSimulation) {
+            runThreaded();
+            return;
+        }
+
+        // Drawn frames tick by the loop's own measure of the previous frame.
+        // raylib's frame time only advances in EndDrawing(), so after an idle
+        // stretch it would cover the gap the idle ticks already made up.
+        float previousFrameSeconds = static_cast<float>(1.0 / displayRate());
+
+        while (!WindowShouldClose() && !quitRequested) {
+            Clock::time_point frameStart = Clock::now();
+            beginFrame();
+            Clock::time_point inputStart = Clock::now();
+            input = pollInput();
+            applyMenuInput(input, snapshots.read().gameState);
+            bool inputActive = isInputActive(input);
+            lastMousePosition = input.mousePosition;
+            phaseMs[PHASE_INPUT] = millisecondsSince(inputStart);
+
+            // An idle wait spans several display frames; tick once for each
+            // so the simulation keeps its pace.
+            if (idleTicks > 0) {
+                frameDelta = static_cast<float>(1.0 / displayRate());
+                for (int i = 0; i < idleTicks; i++) {
+                    tick();
                 }
             }
+            else {
+                frameDelta = previousFrameSeconds;
+                tick();
+            }
+
+            Clock::time_point drawStart = Clock::now();
+            int frames = present(snapshots.read(), inputActive);
+            phaseMs[PHASE_DRAW] = millisecondsSince(drawStart);
+            if (idleFrames == 0) {
+                updateQuality(millisecondsSince(frameStart));
+                paceFrame();
+            }
+            else {
+                pacer.restart();
+            }
+            idleTicks = idleFrames > 0 ? frames : 0;
 
-            update();
-            draw();
+            previousFrameSeconds = millisecondsSince(frameStart) / 1000.0f;
+            recordTelemetry(snapshots.read(), previousFrameSeconds);
         }
     }
 
-    void restart() {
-        balls.clear();
-        particles.clear();
-        if (currentBall) {
-            delete currentBall;
-            currentBall = nullptr;
+    void runThreaded() {
+        simulationRunning = true;
+        std::thread simulationThread(&BallGame::simulationLoop, this);
+
+        while (!WindowShouldClose() && !quitRequested) {
+            Clock::time_point frameStart = Clock::now();
+            beginFrame();
+            Clock::time_point inputStart = Clock::now();
+            const RenderSnapshot& view = snapshots.read();
+            InputState sample = pollInput();
+            applyMenuInput(sample, view.gameState);
+            bool inputActive = isInputActive(sample);
+            lastMousePosition = sample.mousePosition;
+            mergeInput(pendingInput, sample);
+            if (inputQueue.push(pendingInput)) {
+                clearInputEdges(pendingInput);
+            }
+            phaseMs[PHASE_INPUT] = millisecondsSince(inputStart);
+
+            Clock::time_point drawStart = Clock::now();
+            present(view, inputActive);
+            phaseMs[PHASE_DRAW] = millisecondsSince(drawStart);
+            if (idleFrames == 0) {
+                updateQuality(millisecondsSince(frameStart));
+                paceFrame();
+            }
+            else {
+                pacer.restart();
+            }
+
+            recordTelemetry(view, millisecondsSince(frameStart) / 1000.0f);
         }
-        score = 0;
-        if (gameState == PLAYING) {
-            createInitialBalls(isLevelMode);
-            createNewBall();
+
+        simulationRunning = false;
+        simulationThread.join();
+    }
+
+    void simulationLoop() {
+        traceThreadName("simulation");
+        const Clock::duration tickInterval = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(1.0 / options.sim.simulationRate));
+
+        frameDelta = 1.0f / options.sim.simulationRate;
+        Clock::time_point nextTick = Clock::now();
+
+        while (simulationRunning.load(std::memory_order_acquire)) {
+            InputState event;
+            while (inputQueue.pop(event)) {
+                mergeInput(input, event);
+            }
+
+            tick();
+
+            nextTick += tickInterval;
+            Clock::time_point now = Clock::now();
+            if (now - nextTick > tickInterval * 4) {
+                nextTick = now;
+            }
+            std::this_thread::sleep_until(nextTick);
         }
     }
 };
 
-int main() {
-    BallGame game;
+GameOptions parseOptions(int argc, char** argv) {
+    GameOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "--threaded") {
+            options.threadedSimulation = true;
+        }
+        else if (arg == "--track-allocs") {
+            options.trackAllocations = true;
+        }
+        else if (arg == "--power-save") {
+            options.powerSave = true;
+        }
+        else if (arg == "--low-latency") {
+            options.lowLatencyInput = true;
+        }
+        else if (arg == "--input-latency") {
+            options.reportInputLatency = true;
+        }
+        else if (arg.rfind("--telemetry=", 0) == 0) {
+            options.telemetryPath = arg.substr(12);
+        }
+        else if (arg == "--no-telemetry") {
+            options.telemetryPath.clear();
+        }
+        else if (arg.rfind("--rewind-budget=", 0) == 0) {
+            options.sim.rewindBudgetBytes = static_cast<size_t>(std::strtoull(arg.c_str() + 16, nullptr, 10)) * 1024;
+        }
+        else if (arg.rfind("--keyframe-interval=", 0) == 0) {
+            options.sim.rewindKeyframeInterval = static_cast<uint32_t>(std::strtoul(arg.c_str() + 20, nullptr, 10));
+        }
+        else if (arg == "--solver=pbd") {
+            options.sim.solver = SOLVER_PBD;
+        }
+        else if (arg.rfind("--solver-iterations=", 0) == 0) {
+            options.sim.solverIterations = std::max(1, std::atoi(arg.c_str() + 20));
+        }
+        else if (arg.rfind("--render-bench=", 0) == 0) {
+            options.renderBenchFrames = std::max(1, std::atoi(arg.c_str() + 15));
+        }
+        else if (arg.rfind("--bench-level=", 0) == 0) {
+            options.renderBenchLevel = std::clamp(std::atoi(arg.c_str() + 14), 0, static_cast<int>(levelTable.size()));
+        }
+        else if (arg.rfind("--capture=", 0) == 0) {
+            options.captureDir = arg.substr(10);
+        }
+        else if (arg.rfind("--capture-raw=", 0) == 0) {
+            options.captureRawPath = arg.substr(14);
+        }
+        else if (arg.rfind("--trace=", 0) == 0) {
+            options.tracePath = arg.substr(8);
+        }
+        else if (arg.rfind("--seed=", 0) == 0) {
+            options.sim.seed = std::strtoull(arg.c_str() + 7, nullptr, 10);
+        }
+        else if (arg == "--fps=display") {
+            options.matchDisplayRate = true;
+        }
+        else if (arg.rfind("--fps=", 0) == 0) {
+            options.frameRate = std::max(0.0, std::strtod(arg.c_str() + 6, nullptr));
+        }
+        else if (arg == "--frame-stats") {
+            options.reportFrameStats = true;
+        }
+        else if (arg.rfind("--quality=", 0) == 0) {
+            options.qualityLevel = arg == "--quality=auto" ? -1 :
+                std::clamp(std::atoi(arg.c_str() + 10), 0, static_cast<int>(QUALITY_LEVEL_COUNT) - 1);
+        }
+        else if (arg.rfind("--sim-rate=", 0) == 0) {
+            float rate = std::strtof(arg.c_str() + 11, nullptr);
+            if (rate > 0.0f) {
+                options.sim.simulationRate = rate;
+            }
+        }
+    }
+
+    return options;
+}
+
+int main(int argc, char** argv) {
+    BallGame game(parseOptions(argc, argv));
     game.run();
     return 0;
 }
\ No newline at end of file
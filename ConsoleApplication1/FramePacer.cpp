@@ -0,0 +1,97 @@
+#include "FramePacer.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+void FramePacer::setRate(double hz) {
+    interval = hz > 0.0 ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / hz))
+                        : Clock::duration{ 0 };
+    started = false;
+}
+
+double FramePacer::getRate() const {
+    return isCapped() ? 1.0 / std::chrono::duration<double>(interval).count() : 0.0;
+}
+
+void FramePacer::wait() {
+    if (isCapped()) {
+        if (!started) {
+            deadline = Clock::now();
+            started = true;
+        }
+        sleepUntilDeadline();
+    }
+
+    Clock::time_point now = Clock::now();
+    if (isCapped()) {
+        deadline += interval;
+        if (deadline <= now) {
+            deadline = now + interval;
+            missed++;
+        }
+    }
+    record(now);
+}
+
+void FramePacer::sleepUntilDeadline() {
+    Clock::time_point now = Clock::now();
+    Clock::duration sleepFor = deadline - now - spinMargin;
+
+    if (sleepFor > Clock::duration{ 0 }) {
+        std::this_thread::sleep_for(sleepFor);
+        Clock::duration overshoot = Clock::now() - now - sleepFor;
+
+        // Grow at once to cover a longer overshoot, shrink slowly back.
+        if (overshoot > spinMargin) {
+            spinMargin = overshoot + overshoot / 4;
+        }
+        else {
+            spinMargin -= (spinMargin - overshoot) / 16;
+        }
+        spinMargin = std::clamp(spinMargin, minSpinMargin, maxSpinMargin);
+    }
+
+    while (Clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+}
+
+void FramePacer::record(Clock::time_point now) {
+    if (!hasLastFrame) {
+        lastFrame = now;
+        hasLastFrame = true;
+        return;
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(now - lastFrame).count();
+    lastFrame = now;
+
+    // Welford's running mean and variance.
+    frames++;
+    double delta = ms - meanMs;
+    meanMs += delta / frames;
+    sumSquares += delta * (ms - meanMs);
+    minMs = frames == 1 ? ms : std::min(minMs, ms);
+    maxMs = std::max(maxMs, ms);
+}
+
+FrameStats FramePacer::stats() const {
+    FrameStats result{};
+    result.frames = frames;
+    result.missed = missed;
+    result.meanMs = meanMs;
+    result.stddevMs = frames > 1 ? std::sqrt(sumSquares / (frames - 1)) : 0.0;
+    result.minMs = minMs;
+    result.maxMs = maxMs;
+    return result;
+}
+
+void FramePacer::resetStats() {
+    frames = 0;
+    missed = 0;
+    meanMs = 0.0;
+    sumSquares = 0.0;
+    minMs = 0.0;
+    maxMs = 0.0;
+    hasLastFrame = false;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+struct FrameStats {
+    uint32_t frames;
+    uint32_t missed;
+    double meanMs;
+    double stddevMs;
+    double minMs;
+    double maxMs;
+};
+
+// Paces frames to a fixed rate. OS sleeps overshoot by up to a millisecond
+// or two, so the wait sleeps until a margin before the deadline and spins
+// (yielding) for the rest. The margin follows the overshoot the sleeps
+// actually show. Deadlines advance by whole intervals, so a late frame is
+// made up on the next one; a frame late by more than an interval starts
+// the schedule over instead of bursting to catch up.
+class FramePacer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+private:
+    static constexpr Clock::duration minSpinMargin = std::chrono::microseconds(200);
+    static constexpr Clock::duration maxSpinMargin = std::chrono::milliseconds(4);
+
+    Clock::duration interval{ 0 };
+    Clock::duration spinMargin = std::chrono::milliseconds(1);
+    Clock::time_point deadline;
+    Clock::time_point lastFrame;
+    bool started = false;
+    bool hasLastFrame = false;
+
+    uint32_t frames = 0;
+    uint32_t missed = 0;
+    double meanMs = 0.0;
+    double sumSquares = 0.0;
+    double minMs = 0.0;
+    double maxMs = 0.0;
+
+    void sleepUntilDeadline();
+    void record(Clock::time_point now);
+
+public:
+    // A rate of zero or less leaves frames uncapped; wait() then only
+    // records frame times.
+    void setRate(double hz);
+    double getRate() const;
+
+    bool isCapped() const {
+        return interval.count() > 0;
+    }
+
+    // Blocks until the next frame is due.
+    void wait();
+
+    // Starts the schedule over after frames that were not paced, such as
+    // power-save idle waits, so the gap counts as neither a frame nor a miss.
+    void restart() {
+        started = false;
+        hasLastFrame = false;
+    }
+
+    FrameStats stats() const;
+    void resetStats();
+};
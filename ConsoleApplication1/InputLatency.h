@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+struct LatencySummary {
+    uint32_t count;
+    double meanMs;
+    float p50Ms;
+    float p95Ms;
+    float p99Ms;
+    float maxMs;
+};
+
+// Poll-to-present latency of mouse input. Every sampled move or click is
+// given a serial; it is closed by the first presented frame whose snapshot
+// echoes that serial, or, for a move, whose aim was latched from it or a
+// later sample. Latencies land in a fixed histogram so a whole session is
+// summarised without allocating.
+class InputLatency {
+public:
+    using Clock = std::chrono::steady_clock;
+
+private:
+    static constexpr float bucketMs = 0.25f;
+    static constexpr size_t bucketCount = 400;
+
+    struct Pending {
+        uint32_t serial;
+        bool click;
+        Clock::time_point sampled;
+    };
+
+    std::array<Pending, 64> pending;
+    size_t pendingCount = 0;
+
+    std::array<uint32_t, bucketCount + 1> histogram{};
+    uint32_t total = 0;
+    double totalMs = 0.0;
+    float maxMs = 0.0f;
+
+    void record(float ms) {
+        size_t bucket = static_cast<size_t>(ms / bucketMs);
+        histogram[bucket < bucketCount ? bucket : bucketCount]++;
+        total++;
+        totalMs += ms;
+        if (ms > maxMs) maxMs = ms;
+    }
+
+    // Upper edge of the bucket holding the given fraction of samples.
+    float percentile(double fraction) const {
+        uint32_t rank = static_cast<uint32_t>(fraction * total);
+        uint32_t seen = 0;
+        for (size_t i = 0; i < bucketCount; i++) {
+            seen += histogram[i];
+            if (seen > rank) return static_cast<float>(i + 1) * bucketMs;
+        }
+        return maxMs;
+    }
+
+public:
+    // An input that never reaches the screen (power save skipping every
+    // frame, say) would pin its slot; the oldest pending input gives way.
+    void sampled(uint32_t serial, bool click, Clock::time_point now) {
+        if (pendingCount == pending.size()) {
+            for (size_t i = 1; i < pendingCount; i++) {
+                pending[i - 1] = pending[i];
+            }
+            pendingCount--;
+        }
+        pending[pendingCount++] = { serial, click, now };
+    }
+
+    void presented(uint32_t shownSerial, uint32_t latchedSerial, Clock::time_point now) {
+        size_t kept = 0;
+        for (size_t i = 0; i < pendingCount; i++) {
+            const Pending& entry = pending[i];
+            if (entry.serial <= shownSerial || (!entry.click && entry.serial <= latchedSerial)) {
+                record(std::chrono::duration<float, std::milli>(now - entry.sampled).count());
+            }
+            else {
+                pending[kept++] = entry;
+            }
+        }
+        pendingCount = kept;
+    }
+
+    LatencySummary summary() const {
+        LatencySummary result{};
+        result.count = total;
+        if (total == 0) return result;
+
+        result.meanMs = totalMs / total;
+        result.p50Ms = percentile(0.50);
+        result.p95Ms = percentile(0.95);
+        result.p99Ms = percentile(0.99);
+        result.maxMs = maxMs;
+        return result;
+    }
+
+    void printSummary() const {
+        LatencySummary s = summary();
+        std::printf("input to present: %u inputs, mean %.2f ms, p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+            s.count, s.meanMs, s.p50Ms, s.p95Ms, s.p99Ms, s.maxMs);
+    }
+};
@@ -0,0 +1,46 @@
+#include "QualityController.h"
+
+const char* qualityName(QualityLevel level) {
+    switch (level) {
+    case QUALITY_FULL: return "full";
+    case QUALITY_FEWER_PARTICLES: return "fewer_particles";
+    case QUALITY_NO_CONNECTIONS: return "no_connections";
+    case QUALITY_LOW_SEGMENTS: return "low_segments";
+    case QUALITY_NO_OUTLINES: return "no_outlines";
+    default: return "unknown";
+    }
+}
+
+void QualityController::setBudget(float ms) {
+    budgetMs = ms;
+    adaptive = ms > 0.0f;
+    averageMs = 0.0f;
+    framesSinceChange = 0;
+    headroomFrames = 0;
+}
+
+void QualityController::pin(QualityLevel pinned) {
+    adaptive = false;
+    setLevel(pinned);
+}
+
+void QualityController::setLevel(QualityLevel newLevel) {
+    level = newLevel;
+    framesSinceChange = 0;
+    headroomFrames = 0;
+}
+
+void QualityController::update(float frameMs) {
+    averageMs += (frameMs - averageMs) * smoothing;
+    framesSinceChange++;
+    if (!adaptive) return;
+
+    headroomFrames = averageMs < budgetMs * restoreFraction ? headroomFrames + 1 : 0;
+
+    if (averageMs > budgetMs && framesSinceChange >= settleFrames && level + 1 < QUALITY_LEVEL_COUNT) {
+        setLevel(static_cast<QualityLevel>(level + 1));
+    }
+    else if (headroomFrames >= restoreFrames && level > QUALITY_FULL) {
+        setLevel(static_cast<QualityLevel>(level - 1));
+    }
+}
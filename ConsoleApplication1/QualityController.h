@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+
+// Each level keeps every cut of the levels above it.
+enum QualityLevel {
+    QUALITY_FULL,
+    QUALITY_FEWER_PARTICLES,
+    QUALITY_NO_CONNECTIONS,
+    QUALITY_LOW_SEGMENTS,
+    QUALITY_NO_OUTLINES,
+    QUALITY_LEVEL_COUNT
+};
+
+struct QualitySettings {
+    QualityLevel level;
+    int particlePercent;
+    bool connections;
+    int circleSegments;
+    bool outlines;
+};
+
+// circleSegments 0 leaves circles to raylib's own segment count.
+static constexpr std::array<QualitySettings, QUALITY_LEVEL_COUNT> qualityTable = { {
+    { QUALITY_FULL,            100, true,  0,  true },
+    { QUALITY_FEWER_PARTICLES, 40,  true,  0,  true },
+    { QUALITY_NO_CONNECTIONS,  40,  false, 0,  true },
+    { QUALITY_LOW_SEGMENTS,    40,  false, 12, true },
+    { QUALITY_NO_OUTLINES,     25,  false, 12, false },
+} };
+
+static_assert(qualityTable[QUALITY_NO_OUTLINES].level == QUALITY_NO_OUTLINES, "qualityTable rows follow QualityLevel");
+
+const char* qualityName(QualityLevel level);
+
+// Steps render quality down while the rolling frame time is over budget
+// and back up once there is clear headroom. The average is exponential,
+// so a single slow frame does not move it; after each step the controller
+// waits for the average to reflect the new level before stepping again,
+// and restoring needs a sustained stretch well under budget so a level
+// that only just fits does not flap.
+class QualityController {
+    static constexpr float smoothing = 0.1f;
+    static constexpr int settleFrames = 20;
+    static constexpr int restoreFrames = 120;
+    static constexpr float restoreFraction = 0.6f;
+
+    float budgetMs = 0.0f;
+    float averageMs = 0.0f;
+    QualityLevel level = QUALITY_FULL;
+    bool adaptive = true;
+    int framesSinceChange = 0;
+    int headroomFrames = 0;
+
+    void setLevel(QualityLevel newLevel);
+
+public:
+    // A budget of zero or less turns adaptation off.
+    void setBudget(float ms);
+
+    // Pins a level and stops adapting.
+    void pin(QualityLevel pinned);
+
+    // Feeds the work time of one presented frame.
+    void update(float frameMs);
+
+    QualityLevel getLevel() const {
+        return level;
+    }
+
+    const QualitySettings& settings() const {
+        return qualityTable[level];
+    }
+
+    float getAverageMs() const {
+        return averageMs;
+    }
+
+    float getBudgetMs() const {
+        return budgetMs;
+    }
+};
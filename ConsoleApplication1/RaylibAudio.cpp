@@ -0,0 +1,45 @@
+#include "RaylibAudio.h"
+
+bool RaylibAudioBackend::loadCue(SoundCue cue, const SampleBuffer& pcm, int voices) {
+    if (!IsAudioDeviceReady() || pcm.samples.empty() || voices <= 0 || voices > 8) return false;
+
+    Wave wave{};
+    wave.frameCount = static_cast<unsigned int>(pcm.samples.size());
+    wave.sampleRate = pcm.sampleRate;
+    wave.sampleSize = 16;
+    wave.channels = 1;
+    wave.data = const_cast<int16_t*>(pcm.samples.data());
+
+    CueSounds& entry = cues[cue];
+    entry.voices[0] = LoadSoundFromWave(wave);
+    if (entry.voices[0].frameCount == 0) return false;
+
+    for (int voice = 1; voice < voices; voice++) {
+        entry.voices[voice] = LoadSoundAlias(entry.voices[0]);
+    }
+    entry.count = voices;
+    return true;
+}
+
+void RaylibAudioBackend::play(SoundCue cue, int voice, float volume, float pitch) {
+    Sound sound = cues[cue].voices[voice];
+    SetSoundVolume(sound, volume);
+    SetSoundPitch(sound, pitch);
+    PlaySound(sound);
+}
+
+bool RaylibAudioBackend::isPlaying(SoundCue cue, int voice) const {
+    return IsSoundPlaying(cues[cue].voices[voice]);
+}
+
+void RaylibAudioBackend::unload() {
+    for (CueSounds& entry : cues) {
+        if (entry.count == 0) continue;
+
+        for (int voice = entry.count - 1; voice > 0; voice--) {
+            UnloadSoundAlias(entry.voices[voice]);
+        }
+        UnloadSound(entry.voices[0]);
+        entry.count = 0;
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "raylib.h"
+#include "AudioEngine.h"
+
+// Plays cues through raylib. Each cue is uploaded once as a Sound and its
+// extra voices are aliases sharing the same sample data.
+class RaylibAudioBackend : public AudioBackend {
+    struct CueSounds {
+        Sound voices[8];
+        int count = 0;
+    };
+
+    CueSounds cues[CUE_COUNT] = {};
+
+public:
+    bool loadCue(SoundCue cue, const SampleBuffer& pcm, int voices) override;
+    void play(SoundCue cue, int voice, float volume, float pitch) override;
+    bool isPlaying(SoundCue cue, int voice) const override;
+    void unload() override;
+};
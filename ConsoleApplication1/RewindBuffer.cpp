@@ -0,0 +1,173 @@
+#include "RewindBuffer.h"
+
+RewindBuffer::Segment& RewindBuffer::openSegment(uint32_t tick) {
+    Segment segment;
+    if (hasSpare) {
+        segment = std::move(spare);
+        spare = Segment{};
+        hasSpare = false;
+    }
+    segment.firstTick = tick;
+    segment.bytes.clear();
+    segment.frameOffsets.clear();
+    segments.push_back(std::move(segment));
+    return segments.back();
+}
+
+// Keeps one dropped segment's storage for the next keyframe and frees the rest.
+void RewindBuffer::retire(Segment&& segment) {
+    if (hasSpare) {
+        usedBytes -= capacityOf(segment);
+        segment = Segment{};
+        return;
+    }
+    spare = std::move(segment);
+    hasSpare = true;
+}
+
+void RewindBuffer::dropOldest() {
+    retire(std::move(segments.front()));
+    segments.erase(segments.begin());
+}
+
+void RewindBuffer::configure(size_t budget, uint32_t interval) {
+    budgetBytes = budget;
+    keyframeInterval = interval > 0 ? interval : 1;
+    clear();
+}
+
+void RewindBuffer::clear() {
+    while (!segments.empty()) {
+        dropOldest();
+    }
+    needKeyframe = true;
+}
+
+void RewindBuffer::record(uint32_t tick, const SaveStateHeader& header, const PackedBall* projectile,
+    const PackedBall* packedBalls, size_t count) {
+    bool keyframe = needKeyframe || segments.empty() || tick != lastTick + 1 ||
+        tick - segments.back().firstTick >= keyframeInterval;
+
+    Segment& segment = keyframe ? openSegment(tick) : segments.back();
+    size_t capacityBefore = capacityOf(segment);
+    size_t sizeBefore = segment.bytes.size();
+    segment.frameOffsets.push_back(static_cast<uint32_t>(sizeBefore));
+
+    append(segment.bytes, header);
+    if (projectile) {
+        append(segment.bytes, *projectile);
+    }
+
+    if (keyframe) {
+        size_t offset = segment.bytes.size();
+        segment.bytes.resize(offset + count * sizeof(PackedBall));
+        if (count > 0) {
+            std::memcpy(segment.bytes.data() + offset, packedBalls, count * sizeof(PackedBall));
+        }
+        previous.assign(packedBalls, packedBalls + count);
+    }
+    else {
+        size_t countOffset = segment.bytes.size();
+        append(segment.bytes, uint32_t{ 0 });
+
+        uint32_t changed = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (i < previous.size() && std::memcmp(&previous[i], &packedBalls[i], sizeof(PackedBall)) == 0) {
+                continue;
+            }
+            append(segment.bytes, static_cast<uint32_t>(i));
+            append(segment.bytes, packedBalls[i]);
+            changed++;
+        }
+        std::memcpy(segment.bytes.data() + countOffset, &changed, sizeof(changed));
+        previous.assign(packedBalls, packedBalls + count);
+    }
+
+    usedBytes += capacityOf(segment) - capacityBefore;
+    lastTick = tick;
+    needKeyframe = false;
+
+    while (usedBytes > budgetBytes && segments.size() > 1) {
+        dropOldest();
+    }
+    if (usedBytes > budgetBytes && hasSpare) {
+        usedBytes -= capacityOf(spare);
+        spare = Segment{};
+        hasSpare = false;
+    }
+    if (usedBytes > budgetBytes) {
+        needKeyframe = true;
+    }
+}
+
+bool RewindBuffer::reconstruct(uint32_t tick, std::vector<uint8_t>& out) {
+    if (segments.empty() || tick < segments.front().firstTick || tick > lastTick) {
+        return false;
+    }
+
+    size_t index = segments.size() - 1;
+    while (segments[index].firstTick > tick) {
+        index--;
+    }
+    const Segment& segment = segments[index];
+
+    SaveStateHeader header{};
+    PackedBall projectile{};
+    uint32_t frames = tick - segment.firstTick + 1;
+
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        size_t offset = segment.frameOffsets[frame];
+        header = readAt<SaveStateHeader>(segment.bytes, offset);
+        if (header.flags & saveHasProjectile) {
+            projectile = readAt<PackedBall>(segment.bytes, offset);
+        }
+
+        if (frame == 0) {
+            scratch.resize(header.ballCount);
+            if (header.ballCount > 0) {
+                std::memcpy(scratch.data(), segment.bytes.data() + offset, header.ballCount * sizeof(PackedBall));
+            }
+            continue;
+        }
+
+        scratch.resize(header.ballCount);
+        uint32_t changed = readAt<uint32_t>(segment.bytes, offset);
+        for (uint32_t i = 0; i < changed; i++) {
+            uint32_t ballIndex = readAt<uint32_t>(segment.bytes, offset);
+            scratch[ballIndex] = readAt<PackedBall>(segment.bytes, offset);
+        }
+    }
+
+    bool hasProjectile = (header.flags & saveHasProjectile) != 0;
+    out.resize(sizeof(header) + (hasProjectile ? sizeof(PackedBall) : 0) + scratch.size() * sizeof(PackedBall));
+    uint8_t* cursor = out.data();
+    std::memcpy(cursor, &header, sizeof(header));
+    cursor += sizeof(header);
+    if (hasProjectile) {
+        std::memcpy(cursor, &projectile, sizeof(projectile));
+        cursor += sizeof(projectile);
+    }
+    if (!scratch.empty()) {
+        std::memcpy(cursor, scratch.data(), scratch.size() * sizeof(PackedBall));
+    }
+    return true;
+}
+
+void RewindBuffer::truncateAfter(uint32_t tick) {
+    while (!segments.empty() && segments.back().firstTick > tick) {
+        retire(std::move(segments.back()));
+        segments.pop_back();
+    }
+
+    if (!segments.empty()) {
+        Segment& segment = segments.back();
+        uint32_t keep = tick - segment.firstTick + 1;
+        if (keep < segment.frameOffsets.size()) {
+            segment.bytes.resize(segment.frameOffsets[keep]);
+            segment.frameOffsets.resize(keep);
+        }
+    }
+
+    lastTick = tick;
+    needKeyframe = true;
+}
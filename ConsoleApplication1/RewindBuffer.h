@@ -0,0 +1,95 @@
+#pragma once
+
+#include "SimCore.h"
+#include <cstring>
+#include <vector>
+
+// Bounded history of simulation ticks. Each segment opens with a keyframe
+// (a save-state blob without particles) followed by one delta per tick that
+// carries the header, the projectile and only the balls whose packed record
+// changed. Oldest segments are dropped once the byte budget is exceeded;
+// the budget covers allocated capacity, including the one spare segment
+// kept for reuse, and a segment that outgrows the budget on its own is
+// closed early so it can be dropped in turn.
+class RewindBuffer {
+    struct Segment {
+        uint32_t firstTick;
+        std::vector<uint8_t> bytes;
+        std::vector<uint32_t> frameOffsets;
+    };
+
+    std::vector<Segment> segments;
+    Segment spare;
+    bool hasSpare = false;
+    std::vector<PackedBall> previous;
+    std::vector<PackedBall> scratch;
+    size_t budgetBytes;
+    uint32_t keyframeInterval;
+    size_t usedBytes = 0;
+    uint32_t lastTick = 0;
+    bool needKeyframe = true;
+
+    template <typename T>
+    static void append(std::vector<uint8_t>& bytes, const T& value) {
+        size_t offset = bytes.size();
+        bytes.resize(offset + sizeof(T));
+        std::memcpy(bytes.data() + offset, &value, sizeof(T));
+    }
+
+    template <typename T>
+    static T readAt(const std::vector<uint8_t>& bytes, size_t& offset) {
+        T value;
+        std::memcpy(&value, bytes.data() + offset, sizeof(T));
+        offset += sizeof(T);
+        return value;
+    }
+
+    static size_t capacityOf(const Segment& segment) {
+        return segment.bytes.capacity() + segment.frameOffsets.capacity() * sizeof(uint32_t);
+    }
+
+    Segment& openSegment(uint32_t tick);
+
+    void retire(Segment&& segment);
+    void dropOldest();
+
+public:
+    RewindBuffer(size_t budget, uint32_t interval)
+        : budgetBytes(budget), keyframeInterval(interval > 0 ? interval : 1) {
+    }
+
+    void configure(size_t budget, uint32_t interval);
+
+    void clear();
+
+    bool empty() const {
+        return segments.empty();
+    }
+
+    uint32_t oldestTick() const {
+        return segments.empty() ? 0 : segments.front().firstTick;
+    }
+
+    uint32_t newestTick() const {
+        return lastTick;
+    }
+
+    size_t memoryUsed() const {
+        return usedBytes;
+    }
+
+    void record(uint32_t tick, const SaveStateHeader& header, const PackedBall* projectile,
+        const PackedBall* packedBalls, size_t count);
+
+    // Rebuilds the state at `tick` as a save-state blob for BubbleSim::loadState.
+    bool reconstruct(uint32_t tick, std::vector<uint8_t>& out);
+
+    // Starts a new segment at the next record, e.g. after the balls were
+    // reordered and per-index deltas would touch every ball anyway.
+    void requestKeyframe() {
+        needKeyframe = true;
+    }
+
+    // Forgets everything recorded after `tick`, e.g. after seeking back.
+    void truncateAfter(uint32_t tick);
+};
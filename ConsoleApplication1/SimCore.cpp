@@ -0,0 +1,57 @@
+#include "SimCore.h"
+#include <cstdio>
+
+AllocTracker allocTracker;
+
+const char* AllocTracker::tagName(AllocTag tag) {
+    static const char* names[TAG_COUNT] = { "balls", "particles", "textures", "scratch", "strings" };
+    return names[tag];
+}
+
+void AllocTracker::printSummary() const {
+    std::printf("Allocation summary:\n");
+    std::printf("  %-10s %12s %14s %12s %12s\n", "tag", "allocs", "bytes", "live", "peak");
+    for (int i = 0; i < TAG_COUNT; i++) {
+        const AllocStats& entry = stats[i];
+        std::printf("  %-10s %12llu %14llu %12lld %12lld\n", tagName(static_cast<AllocTag>(i)),
+            static_cast<unsigned long long>(entry.allocations.load()),
+            static_cast<unsigned long long>(entry.bytes.load()),
+            static_cast<long long>(entry.liveBytes.load()),
+            static_cast<long long>(entry.peakBytes.load()));
+    }
+}
+
+void ColorOccupancy::rebuild(const BallList& balls) {
+    size_t words = (balls.size() + 63) / 64;
+    for (std::vector<uint64_t>& entry : members) {
+        entry.assign(words, 0);
+    }
+    counts.fill(0);
+
+    for (size_t i = 0; i < balls.size(); i++) {
+        if (balls[i].active) {
+            add(i, balls[i].color);
+        }
+    }
+}
+
+void ColorOccupancy::add(size_t index, BallColor color) {
+    if (!tracks(color)) return;
+
+    std::vector<uint64_t>& words = members[color & colorIndexMask];
+    if (words.size() <= index / 64) {
+        for (std::vector<uint64_t>& entry : members) {
+            entry.resize(index / 64 + 1, 0);
+        }
+    }
+    words[index / 64] |= uint64_t{ 1 } << (index % 64);
+    counts[color & colorIndexMask]++;
+}
+
+void ColorOccupancy::recolor(size_t index, BallColor from, BallColor to) {
+    if (tracks(from)) {
+        members[from & colorIndexMask][index / 64] &= ~(uint64_t{ 1 } << (index % 64));
+        counts[from & colorIndexMask]--;
+    }
+    add(index, to);
+}
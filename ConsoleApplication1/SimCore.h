@@ -0,0 +1,574 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// The simulation only needs raylib's plain data types. Game translation units
+// include raylib.h first and use its definitions; headless builds get the
+// same declarations here.
+#if !defined(RAYLIB_H)
+#define CLITERAL(type) type
+
+typedef struct Vector2 {
+    float x;
+    float y;
+} Vector2;
+
+typedef struct Color {
+    unsigned char r;
+    unsigned char g;
+    unsigned char b;
+    unsigned char a;
+} Color;
+
+#define YELLOW     CLITERAL(Color){ 253, 249, 0, 255 }
+#define ORANGE     CLITERAL(Color){ 255, 161, 0, 255 }
+#define PINK       CLITERAL(Color){ 255, 109, 194, 255 }
+#define RED        CLITERAL(Color){ 230, 41, 55, 255 }
+#define MAROON     CLITERAL(Color){ 190, 33, 55, 255 }
+#define GREEN      CLITERAL(Color){ 0, 228, 48, 255 }
+#define LIME       CLITERAL(Color){ 0, 158, 47, 255 }
+#define DARKGREEN  CLITERAL(Color){ 0, 117, 44, 255 }
+#define SKYBLUE    CLITERAL(Color){ 102, 191, 255, 255 }
+#define BLUE       CLITERAL(Color){ 0, 121, 241, 255 }
+#define DARKBLUE   CLITERAL(Color){ 0, 82, 172, 255 }
+#define PURPLE     CLITERAL(Color){ 200, 122, 255, 255 }
+#define VIOLET     CLITERAL(Color){ 135, 60, 190, 255 }
+#define DARKPURPLE CLITERAL(Color){ 112, 31, 126, 255 }
+#define WHITE      CLITERAL(Color){ 255, 255, 255, 255 }
+#define BLACK      CLITERAL(Color){ 0, 0, 0, 255 }
+#endif
+
+enum GameState {
+    MAIN_MENU,
+    LEVEL_SELECT,
+    PLAYING,
+    GAME_OVER,
+    GAME_WON
+};
+
+enum BallType {
+    NORMAL,
+    UNIVERSAL,
+    BOMB,
+    RAINBOW,
+    BALL_TYPE_COUNT
+};
+
+inline constexpr std::array<Color, 10> ballPalette = {
+    RED, BLUE, GREEN, YELLOW, PURPLE, ORANGE, PINK, SKYBLUE, LIME, VIOLET
+};
+
+// A ball's colour is one byte: the low bits index ballPalette and the high
+// bits mark balls that match any colour. Bombs use an index outside the
+// palette; colorIgnore is never equal to a ball colour and is used to mask
+// balls out of the match kernels.
+using BallColor = uint8_t;
+
+inline constexpr BallColor colorIndexMask = 0x0F;
+inline constexpr BallColor colorUniversalFlag = 0x40;
+inline constexpr BallColor colorRainbowFlag = 0x80;
+inline constexpr BallColor colorWildMask = colorUniversalFlag | colorRainbowFlag;
+inline constexpr BallColor colorBomb = 0x0F;
+inline constexpr BallColor colorIgnore = 0x30;
+
+// Everything that differs between ball types, one row per BallType. Code
+// that handles balls reads its row instead of switching on the type, so a
+// new type is an enum value and a row here.
+struct BallTypeTraits {
+    BallType type;
+    BallColor colorFlags;
+    bool keepsColor;
+    bool savesColor;
+    bool matchesAlone;
+    bool activatesOnMatch;
+    bool explodesOnAttach;
+    bool cyclesColor;
+    bool showsBlastRadius;
+    int matchBonus;
+};
+
+inline constexpr std::array<BallTypeTraits, BALL_TYPE_COUNT> ballTypeTraits = { {
+    // type      flags               keeps  saves  alone  activ  expl   cycle  blast  bonus
+    { NORMAL,    0,                  true,  true,  false, false, false, false, false, 0 },
+    { UNIVERSAL, colorUniversalFlag, false, false, true,  false, false, false, false, 50 },
+    { BOMB,      colorBomb,          false, false, false, false, true,  false, true,  0 },
+    { RAINBOW,   colorRainbowFlag,   false, true,  false, true,  false, true,  false, 0 },
+} };
+
+constexpr bool ballTypeTraitsInOrder() {
+    for (size_t i = 0; i < ballTypeTraits.size(); i++) {
+        if (ballTypeTraits[i].type != static_cast<BallType>(i)) return false;
+    }
+    return true;
+}
+static_assert(ballTypeTraitsInOrder(), "ballTypeTraits rows must follow the BallType order");
+
+inline const BallTypeTraits& traitsOf(BallType type) {
+    return ballTypeTraits[type];
+}
+
+inline int lowestSetBit(uint64_t bits) {
+#if defined(_MSC_VER) && !defined(_M_X64) && !defined(_M_ARM64)
+    // 32-bit MSVC has no _BitScanForward64.
+    unsigned long index;
+    if (_BitScanForward(&index, static_cast<unsigned long>(bits))) return static_cast<int>(index);
+    _BitScanForward(&index, static_cast<unsigned long>(bits >> 32));
+    return static_cast<int>(index) + 32;
+#elif defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(bits);
+#endif
+}
+
+inline Color paletteColor(BallColor color) {
+    if (color & colorUniversalFlag) return WHITE;
+    if ((color & colorIndexMask) >= ballPalette.size()) return BLACK;
+    return ballPalette[color & colorIndexMask];
+}
+
+enum AllocTag {
+    TAG_BALLS,
+    TAG_PARTICLES,
+    TAG_TEXTURES,
+    TAG_SCRATCH,
+    TAG_STRINGS,
+    TAG_COUNT
+};
+
+struct AllocStats {
+    std::atomic<uint64_t> allocations{ 0 };
+    std::atomic<uint64_t> bytes{ 0 };
+    std::atomic<int64_t> liveAllocations{ 0 };
+    std::atomic<int64_t> liveBytes{ 0 };
+    std::atomic<int64_t> peakBytes{ 0 };
+};
+
+// Opt-in per-subsystem memory accounting. Containers opt in through
+// TrackingAllocator; textures and scratch memory report explicitly.
+class AllocTracker {
+    AllocStats stats[TAG_COUNT];
+
+public:
+    std::atomic<bool> enabled{ false };
+
+    void recordAllocation(AllocTag tag, size_t size) {
+        if (!enabled.load(std::memory_order_relaxed)) return;
+
+        AllocStats& entry = stats[tag];
+        entry.allocations.fetch_add(1, std::memory_order_relaxed);
+        entry.bytes.fetch_add(size, std::memory_order_relaxed);
+        entry.liveAllocations.fetch_add(1, std::memory_order_relaxed);
+        int64_t live = entry.liveBytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed) +
+            static_cast<int64_t>(size);
+
+        int64_t peak = entry.peakBytes.load(std::memory_order_relaxed);
+        while (live > peak && !entry.peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+        }
+    }
+
+    void recordRelease(AllocTag tag, size_t size, int64_t count = 1) {
+        if (!enabled.load(std::memory_order_relaxed)) return;
+
+        stats[tag].liveAllocations.fetch_sub(count, std::memory_order_relaxed);
+        stats[tag].liveBytes.fetch_sub(static_cast<int64_t>(size), std::memory_order_relaxed);
+    }
+
+    const AllocStats& get(AllocTag tag) const {
+        return stats[tag];
+    }
+
+    static const char* tagName(AllocTag tag);
+    void printSummary() const;
+};
+
+extern AllocTracker allocTracker;
+
+template <typename T, AllocTag Tag>
+struct TrackingAllocator {
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = TrackingAllocator<U, Tag>;
+    };
+
+    TrackingAllocator() noexcept = default;
+
+    template <typename U>
+    TrackingAllocator(const TrackingAllocator<U, Tag>&) noexcept {
+    }
+
+    T* allocate(size_t n) {
+        allocTracker.recordAllocation(Tag, n * sizeof(T));
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* block, size_t n) noexcept {
+        allocTracker.recordRelease(Tag, n * sizeof(T));
+        ::operator delete(block);
+    }
+};
+
+template <typename T, typename U, AllocTag Tag>
+bool operator==(const TrackingAllocator<T, Tag>&, const TrackingAllocator<U, Tag>&) {
+    return true;
+}
+
+template <typename T, typename U, AllocTag Tag>
+bool operator!=(const TrackingAllocator<T, Tag>&, const TrackingAllocator<U, Tag>&) {
+    return false;
+}
+
+using TrackedString = std::basic_string<char, std::char_traits<char>, TrackingAllocator<char, TAG_STRINGS>>;
+
+struct Level {
+    int levelNumber;
+    int targetScore;
+    int ballCount;
+    int specialBallChance;
+    bool allowBomb;
+    bool allowRainbow;
+    bool allowUniversal;
+    const char* name;
+    Color backgroundColor;
+};
+
+using LevelTable = std::array<Level, 5>;
+
+inline constexpr LevelTable levelTable = { {
+    // number, target, balls, special %, bomb, rainbow, universal, name, background
+    { 1, 500, 50, 0, false, false, false, "Tutorial", DARKBLUE },
+    { 2, 1000, 70, 5, true, false, false, "Easy Mode", DARKGREEN },
+    { 3, 2000, 90, 10, true, true, false, "Medium Challenge", PURPLE },
+    { 4, 3500, 110, 15, true, true, true, "Hard Level", DARKPURPLE },
+    { 5, 5000, 130, 20, true, true, true, "Expert Mode", MAROON },
+} };
+
+struct Ball {
+    Vector2 position;
+    Vector2 velocity;
+    Vector2 acceleration;
+    float radius;
+    BallColor color;
+    bool active;
+    bool isStuck;
+    float stiffness;
+    float damping;
+    Vector2 originalPosition;
+    bool hasSupport;
+    BallType type;
+    bool isSpecial;
+    int bombRadius;
+
+    Ball(float x, float y, float r, BallColor c, BallType t = NORMAL)
+        : position{ x, y }, velocity{ 0, 0 }, acceleration{ 0, 0 },
+        radius(r), color(c), active(true), isStuck(true),
+        stiffness(0.08f), damping(0.92f), originalPosition{ x, y },
+        hasSupport(true), type(t), isSpecial(t != NORMAL),
+        bombRadius(static_cast<int>(r * 3)) {
+
+        if (!ballTypeTraits[type].keepsColor) {
+            color = ballTypeTraits[type].colorFlags;
+        }
+    }
+};
+
+// Small xorshift64* generator for simulation randomness. Its whole state is
+// one word, so it can be saved and restored with the rest of the game.
+struct SimRng {
+    using result_type = uint32_t;
+
+    uint64_t state;
+
+    explicit SimRng(uint64_t seed = 0x9E3779B97F4A7C15ull) {
+        this->seed(seed);
+    }
+
+    void seed(uint64_t value) {
+        state = value ? value : 0x9E3779B97F4A7C15ull;
+    }
+
+    static constexpr result_type min() {
+        return 0;
+    }
+
+    static constexpr result_type max() {
+        return 0xFFFFFFFFu;
+    }
+
+    result_type operator()() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return static_cast<result_type>((state * 0x2545F4914F6CDD1Dull) >> 32);
+    }
+};
+
+// Save-state records. Positions are stored in 1/16 px, velocities in
+// 1/256 px per tick, colours as indices into the ball palette.
+struct PackedBall {
+    int16_t positionX;
+    int16_t positionY;
+    int16_t velocityX;
+    int16_t velocityY;
+    int16_t originX;
+    int16_t originY;
+    uint8_t paletteIndex;
+    uint8_t flags;
+};
+
+struct PackedParticle {
+    int16_t positionX;
+    int16_t positionY;
+    int16_t velocityX;
+    int16_t velocityY;
+    Color color;
+    uint16_t size;
+    uint16_t life;
+};
+
+struct SaveStateHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t flags;
+    int32_t score;
+    int32_t currentLevel;
+    uint64_t rngState;
+    float rainbowTimer;
+    int16_t aimDirectionX;
+    int16_t aimDirectionY;
+    uint8_t gameState;
+    uint8_t isLevelMode;
+    uint8_t isAiming;
+    uint8_t reserved;
+    uint32_t ballCount;
+    uint32_t particleCount;
+    uint32_t boardSeed;
+};
+
+constexpr uint16_t saveHasParticles = 0x1;
+constexpr uint16_t saveHasProjectile = 0x2;
+
+static_assert(sizeof(PackedBall) == 14, "PackedBall layout changed");
+static_assert(sizeof(PackedParticle) == 16, "PackedParticle layout changed");
+
+// Linear scratch memory for a single simulation tick. Everything allocated
+// from it is dropped at once by reset(); only an overflow past the inline
+// buffer reaches the heap.
+class FrameArena : public std::pmr::memory_resource {
+    static constexpr size_t capacity = 64 * 1024;
+
+    alignas(std::max_align_t) unsigned char buffer[capacity];
+    std::pmr::monotonic_buffer_resource resource{ buffer, capacity, std::pmr::new_delete_resource() };
+    size_t allocatedBytes = 0;
+    int64_t allocationCount = 0;
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        allocatedBytes += bytes;
+        allocationCount++;
+        allocTracker.recordAllocation(TAG_SCRATCH, bytes);
+        return resource.allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void*, size_t, size_t) override {
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+public:
+    void reset() {
+        allocTracker.recordRelease(TAG_SCRATCH, allocatedBytes, allocationCount);
+        allocatedBytes = 0;
+        allocationCount = 0;
+        resource.release();
+    }
+};
+
+struct ColorGrid {
+    std::pmr::vector<BallColor> cells;
+    int columns;
+
+    ColorGrid(int rows, int cols, std::pmr::memory_resource* resource)
+        : cells(static_cast<size_t>(rows) * static_cast<size_t>(cols), colorIgnore, resource), columns(cols) {
+    }
+
+    BallColor& at(int row, int col) {
+        return cells[static_cast<size_t>(row) * static_cast<size_t>(columns) + static_cast<size_t>(col)];
+    }
+
+    BallColor at(int row, int col) const {
+        return cells[static_cast<size_t>(row) * static_cast<size_t>(columns) + static_cast<size_t>(col)];
+    }
+};
+
+struct Particle {
+    Vector2 position;
+    Vector2 velocity;
+    Color color;
+    float size;
+    float life;
+};
+
+// Gameplay events appended by the simulation during a tick. `count` is the
+// number of balls involved (match size, bomb or rainbow victims); popped
+// balls carry the event that removed them in `source`.
+enum SimEventType {
+    EVENT_SHOT,
+    EVENT_ATTACH,
+    EVENT_DROP,
+    EVENT_MATCH,
+    EVENT_POP,
+    EVENT_BOMB,
+    EVENT_RAINBOW,
+    EVENT_LEVEL_COMPLETE,
+    EVENT_GAME_OVER,
+    EVENT_GAME_WON
+};
+
+struct SimEvent {
+    SimEventType type;
+    SimEventType source;
+    BallType ballType;
+    Vector2 position;
+    Color color;
+    int count;
+};
+
+// Menu actions resolved by the UI and applied by the simulation.
+enum SimCommand {
+    COMMAND_NONE,
+    COMMAND_START_ENDLESS,
+    COMMAND_START_LEVEL,
+    COMMAND_OPEN_LEVEL_SELECT,
+    COMMAND_MAIN_MENU
+};
+
+// Input sampled on the window thread and consumed by the simulation tick.
+// Button and key fields are edges: they stay set until a tick consumes them.
+struct InputState {
+    Vector2 mousePosition;
+    SimCommand command;
+    int commandLevel;
+    bool mouseLeftPressed;
+    bool restartPressed;
+    bool menuPressed;
+    bool escapePressed;
+    bool saveStatePressed;
+    bool loadStatePressed;
+    bool undoShotPressed;
+    bool rewindPressed;
+    // Stamped by the window side so it can tell which frame first shows an
+    // input; the simulation only echoes it into the snapshot.
+    uint32_t serial;
+};
+
+inline void mergeInput(InputState& into, const InputState& from) {
+    into.mousePosition = from.mousePosition;
+    into.serial = from.serial;
+    if (from.command != COMMAND_NONE) {
+        into.command = from.command;
+        into.commandLevel = from.commandLevel;
+    }
+    into.mouseLeftPressed = into.mouseLeftPressed || from.mouseLeftPressed;
+    into.restartPressed = into.restartPressed || from.restartPressed;
+    into.menuPressed = into.menuPressed || from.menuPressed;
+    into.escapePressed = into.escapePressed || from.escapePressed;
+    into.saveStatePressed = into.saveStatePressed || from.saveStatePressed;
+    into.loadStatePressed = into.loadStatePressed || from.loadStatePressed;
+    into.undoShotPressed = into.undoShotPressed || from.undoShotPressed;
+    into.rewindPressed = into.rewindPressed || from.rewindPressed;
+}
+
+inline void clearInputEdges(InputState& state) {
+    state.command = COMMAND_NONE;
+    state.mouseLeftPressed = false;
+    state.restartPressed = false;
+    state.menuPressed = false;
+    state.escapePressed = false;
+    state.saveStatePressed = false;
+    state.loadStatePressed = false;
+    state.undoShotPressed = false;
+    state.rewindPressed = false;
+}
+
+struct BallView {
+    Vector2 position;
+    float radius;
+    Color color;
+    BallType type;
+    int bombRadius;
+    bool isStuck;
+};
+
+using BallList = std::vector<Ball, TrackingAllocator<Ball, TAG_BALLS>>;
+using ParticleList = std::vector<Particle, TrackingAllocator<Particle, TAG_PARTICLES>>;
+
+using ColorCounts = std::array<uint16_t, ballPalette.size()>;
+
+// Which balls hold each palette colour, as bitsets over ball indices, and
+// how many. Rainbow balls count under their current colour; universal
+// balls and bombs are not tracked. Indices shift when the ball list is
+// compacted, so the owner rebuilds after every erase.
+class ColorOccupancy {
+    std::array<std::vector<uint64_t>, ballPalette.size()> members;
+    ColorCounts counts{};
+
+public:
+    static bool tracks(BallColor color) {
+        return (color & colorUniversalFlag) == 0 && (color & colorIndexMask) < ballPalette.size();
+    }
+
+    void rebuild(const BallList& balls);
+    void add(size_t index, BallColor color);
+    void recolor(size_t index, BallColor from, BallColor to);
+
+    const ColorCounts& getCounts() const {
+        return counts;
+    }
+
+    // Calls visit(index) for every ball of `paletteIndex`, lowest index first.
+    template <typename Visitor>
+    void forEach(BallColor paletteIndex, Visitor visit) const {
+        const std::vector<uint64_t>& words = members[paletteIndex];
+        for (size_t word = 0; word < words.size(); word++) {
+            uint64_t bits = words[word];
+            while (bits) {
+                visit(word * 64 + static_cast<size_t>(lowestSetBit(bits)));
+                bits &= bits - 1;
+            }
+        }
+    }
+};
+
+// Everything the renderer needs from one simulation tick. Snapshots are
+// rewritten in place, so their vectors keep capacity between ticks.
+struct RenderSnapshot {
+    std::vector<BallView, TrackingAllocator<BallView, TAG_BALLS>> balls;
+    ParticleList particles;
+    BallView currentBall;
+    bool hasCurrentBall;
+    bool isAiming;
+    Vector2 aimDirection;
+    int score;
+    GameState gameState;
+    int currentLevel;
+    bool isLevelMode;
+    size_t rewindBytes;
+    ColorCounts colorCounts;
+    uint32_t inputSerial;
+};
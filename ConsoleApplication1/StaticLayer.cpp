@@ -0,0 +1,56 @@
+#include "StaticLayer.h"
+#include "SimCore.h"
+#include "rlgl.h"
+
+static size_t targetBytes(const RenderTexture2D& target) {
+    return static_cast<size_t>(target.texture.width) * static_cast<size_t>(target.texture.height) * 4;
+}
+
+void StaticLayer::begin(int width, int height, int layerKey) {
+    if (target.id == 0 || target.texture.width != width || target.texture.height != height) {
+        unload();
+        target = LoadRenderTexture(width, height);
+        allocTracker.recordAllocation(TAG_TEXTURES, targetBytes(target));
+    }
+
+    key = layerKey;
+    valid = true;
+
+    BeginTextureMode(target);
+    ClearBackground(BLANK);
+
+    // Colour is premultiplied on the way in; alpha accumulates as coverage,
+    // so a layer with an opaque base stays opaque under translucent content.
+    rlSetBlendFactorsSeparate(RL_SRC_ALPHA, RL_ONE_MINUS_SRC_ALPHA, RL_ONE, RL_ONE_MINUS_SRC_ALPHA,
+        RL_FUNC_ADD, RL_FUNC_ADD);
+    BeginBlendMode(BLEND_CUSTOM_SEPARATE);
+}
+
+void StaticLayer::end() {
+    EndBlendMode();
+    EndTextureMode();
+}
+
+void StaticLayer::draw() const {
+    if (target.id == 0) return;
+
+    if (overlay) {
+        BeginBlendMode(BLEND_ALPHA_PREMULTIPLY);
+    }
+
+    Rectangle source = { 0.0f, 0.0f, static_cast<float>(target.texture.width), -static_cast<float>(target.texture.height) };
+    DrawTextureRec(target.texture, source, { 0.0f, 0.0f }, WHITE);
+
+    if (overlay) {
+        EndBlendMode();
+    }
+}
+
+void StaticLayer::unload() {
+    if (target.id != 0) {
+        allocTracker.recordRelease(TAG_TEXTURES, targetBytes(target));
+        UnloadRenderTexture(target);
+        target = RenderTexture2D{};
+    }
+    valid = false;
+}
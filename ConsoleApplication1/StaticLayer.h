@@ -0,0 +1,37 @@
+#pragma once
+
+#include "raylib.h"
+
+// Screen-sized render texture that is redrawn only when its key changes.
+// Layers are recorded premultiplied with alpha as coverage. A layer with an
+// opaque base blits opaque; overlay layers are blitted premultiplied over
+// live content with the same result as drawing them directly.
+class StaticLayer {
+    RenderTexture2D target{};
+    int key = 0;
+    bool valid = false;
+    bool overlay;
+
+public:
+    explicit StaticLayer(bool isOverlay = false) : overlay(isOverlay) {
+    }
+
+    StaticLayer(const StaticLayer&) = delete;
+    StaticLayer& operator=(const StaticLayer&) = delete;
+
+    bool isCurrent(int layerKey) const {
+        return valid && key == layerKey;
+    }
+
+    // Starts recording the layer contents; pair with end().
+    void begin(int width, int height, int layerKey);
+    void end();
+
+    void draw() const;
+
+    void invalidate() {
+        valid = false;
+    }
+
+    void unload();
+};
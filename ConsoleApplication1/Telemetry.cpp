@@ -0,0 +1,236 @@
+#include "Telemetry.h"
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+
+static const char* eventName(SimEventType type) {
+    switch (type) {
+    case EVENT_GAME_OVER: return "game_over";
+    case EVENT_LEVEL_COMPLETE: return "level_complete";
+    case EVENT_GAME_WON: return "game_won";
+    default: return "other";
+    }
+}
+
+static const char* phaseName(int phase) {
+    switch (phase) {
+    case PHASE_INPUT: return "input";
+    case PHASE_SIM: return "sim";
+    case PHASE_DRAW: return "draw";
+    default: return "other";
+    }
+}
+
+Telemetry::~Telemetry() {
+    close();
+}
+
+bool Telemetry::open(const char* path) {
+    if (file) return true;
+
+    file = std::fopen(path, "ab");
+    if (!file) return false;
+
+    std::setvbuf(file, nullptr, _IOFBF, 64 * 1024);
+    running = true;
+    writer = std::thread(&Telemetry::writeLoop, this);
+    return true;
+}
+
+void Telemetry::close() {
+    if (!file) return;
+
+    if (inSession) {
+        endSession(current.score);
+    }
+
+    running = false;
+    writer.join();
+    std::fclose(file);
+    file = nullptr;
+}
+
+void Telemetry::submit(const TelemetryRecord& record) {
+    if (!queue.push(record)) {
+        current.dropped++;
+    }
+}
+
+void Telemetry::beginSession(int level, bool levelMode, uint64_t seed) {
+    if (!file) return;
+    if (inSession) {
+        endSession(current.score);
+    }
+
+    current = TelemetryRecord{};
+    current.session = ++sessionId;
+    current.level = level;
+    current.levelMode = levelMode;
+    current.seed = seed;
+    current.startedAt = static_cast<int64_t>(std::time(nullptr));
+    sessionTime = 0.0f;
+    nextSample = 0.0f;
+    inSession = true;
+
+    TelemetryRecord start = current;
+    start.type = RECORD_SESSION_START;
+    submit(start);
+}
+
+void Telemetry::endSession(int score) {
+    if (!inSession) return;
+
+    current.type = RECORD_SESSION_END;
+    current.time = sessionTime;
+    current.score = score;
+    submit(current);
+    inSession = false;
+}
+
+void Telemetry::observe(const SimEvent& event, int score) {
+    if (!inSession) return;
+
+    switch (event.type) {
+    case EVENT_SHOT:
+        current.shots++;
+        break;
+    case EVENT_MATCH: {
+        int tier = event.count >= 10 ? 3 : event.count >= 7 ? 2 : event.count >= 5 ? 1 : 0;
+        current.matches[static_cast<size_t>(tier)]++;
+        break;
+    }
+    case EVENT_GAME_OVER:
+    case EVENT_LEVEL_COMPLETE:
+    case EVENT_GAME_WON: {
+        TelemetryRecord record = current;
+        record.type = RECORD_EVENT;
+        record.time = sessionTime;
+        record.event = event.type;
+        record.score = score;
+        record.level = event.type == EVENT_GAME_OVER ? current.level : event.count;
+        submit(record);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void Telemetry::frame(float frameSeconds, const std::array<float, PHASE_COUNT>& phaseMs, size_t balls,
+    size_t particles, int score, QualityLevel quality) {
+    if (!inSession) return;
+
+    float frameMs = frameSeconds * 1000.0f;
+    size_t bucket = 0;
+    while (bucket < telemetryFrameBuckets.size() && frameMs >= telemetryFrameBuckets[bucket]) {
+        bucket++;
+    }
+    current.frameHistogram[bucket]++;
+    current.frames++;
+    current.qualityFrames[static_cast<size_t>(quality)]++;
+
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        PhaseStats& entry = current.phases[static_cast<size_t>(phase)];
+        entry.totalMs += phaseMs[static_cast<size_t>(phase)];
+        entry.maxMs = std::max(entry.maxMs, phaseMs[static_cast<size_t>(phase)]);
+    }
+
+    current.peakParticles = std::max(current.peakParticles, static_cast<int>(particles));
+    current.score = score;
+    sessionTime += frameSeconds;
+
+    if (sessionTime >= nextSample) {
+        TelemetryRecord sample = current;
+        sample.type = RECORD_SAMPLE;
+        sample.time = sessionTime;
+        sample.balls = static_cast<int>(balls);
+        sample.particles = static_cast<int>(particles);
+        sample.quality = quality;
+        submit(sample);
+        nextSample = sessionTime + sampleInterval;
+    }
+}
+
+void Telemetry::writeLoop() {
+    bool pending = false;
+
+    for (;;) {
+        bool stopping = !running.load(std::memory_order_acquire);
+
+        TelemetryRecord record;
+        bool wrote = false;
+        while (queue.pop(record)) {
+            writeRecord(record);
+            wrote = true;
+        }
+
+        if (wrote) {
+            pending = true;
+            continue;
+        }
+        if (pending) {
+            std::fflush(file);
+            pending = false;
+        }
+        if (stopping) break;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+}
+
+void Telemetry::writeRecord(const TelemetryRecord& record) {
+    switch (record.type) {
+    case RECORD_SESSION_START:
+        std::fprintf(file, "{\"type\":\"session_start\",\"session\":%u,\"started\":%lld,\"mode\":\"%s\","
+            "\"level\":%d,\"seed\":%llu}\n",
+            record.session, static_cast<long long>(record.startedAt), record.levelMode ? "level" : "endless",
+            record.level, static_cast<unsigned long long>(record.seed));
+        break;
+
+    case RECORD_SAMPLE:
+        std::fprintf(file, "{\"type\":\"sample\",\"session\":%u,\"t\":%.2f,\"balls\":%d,\"particles\":%d,"
+            "\"score\":%d,\"quality\":\"%s\"}\n",
+            record.session, record.time, record.balls, record.particles, record.score, qualityName(record.quality));
+        break;
+
+    case RECORD_EVENT:
+        std::fprintf(file, "{\"type\":\"event\",\"session\":%u,\"t\":%.2f,\"event\":\"%s\",\"level\":%d,"
+            "\"score\":%d}\n",
+            record.session, record.time, eventName(record.event), record.level, record.score);
+        break;
+
+    case RECORD_SESSION_END: {
+        const std::array<int, telemetryMatchTiers>& m = record.matches;
+        std::fprintf(file, "{\"type\":\"session_end\",\"session\":%u,\"t\":%.2f,\"frames\":%u,\"score\":%d,"
+            "\"shots\":%d,\"peak_particles\":%d,\"dropped\":%u,"
+            "\"matches\":{\"4\":%d,\"5-6\":%d,\"7-9\":%d,\"10+\":%d},\"frame_ms\":{",
+            record.session, record.time, record.frames, record.score, record.shots, record.peakParticles,
+            record.dropped, m[0], m[1], m[2], m[3]);
+
+        for (size_t i = 0; i < record.frameHistogram.size(); i++) {
+            if (i < telemetryFrameBuckets.size()) {
+                std::fprintf(file, "%s\"<%g\":%u", i > 0 ? "," : "", telemetryFrameBuckets[i],
+                    record.frameHistogram[i]);
+            }
+            else {
+                std::fprintf(file, ",\">=%g\":%u", telemetryFrameBuckets.back(), record.frameHistogram[i]);
+            }
+        }
+
+        std::fprintf(file, "},\"phases\":{");
+        double frames = record.frames > 0 ? static_cast<double>(record.frames) : 1.0;
+        for (int phase = 0; phase < PHASE_COUNT; phase++) {
+            const PhaseStats& entry = record.phases[static_cast<size_t>(phase)];
+            std::fprintf(file, "%s\"%s\":{\"mean_ms\":%.3f,\"max_ms\":%.3f}", phase > 0 ? "," : "",
+                phaseName(phase), entry.totalMs / frames, entry.maxMs);
+        }
+        std::fprintf(file, "},\"quality_frames\":{");
+        for (int level = 0; level < QUALITY_LEVEL_COUNT; level++) {
+            std::fprintf(file, "%s\"%s\":%u", level > 0 ? "," : "", qualityName(static_cast<QualityLevel>(level)),
+                record.qualityFrames[static_cast<size_t>(level)]);
+        }
+        std::fprintf(file, "}}\n");
+        break;
+    }
+    }
+}
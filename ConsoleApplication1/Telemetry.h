@@ -0,0 +1,114 @@
+#pragma once
+
+#include "SimCore.h"
+#include "Concurrency.h"
+#include "QualityController.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+
+enum TelemetryPhase {
+    PHASE_INPUT,
+    PHASE_SIM,
+    PHASE_DRAW,
+    PHASE_COUNT
+};
+
+enum TelemetryRecordType {
+    RECORD_SESSION_START,
+    RECORD_SAMPLE,
+    RECORD_EVENT,
+    RECORD_SESSION_END
+};
+
+// Upper bounds of the frame-time histogram buckets in milliseconds; the
+// last bucket collects everything slower.
+static constexpr std::array<float, 9> telemetryFrameBuckets = {
+    4.0f, 8.0f, 12.0f, 16.7f, 20.0f, 25.0f, 33.4f, 50.0f, 100.0f
+};
+
+// Match sizes grouped like the score tiers: 4, 5-6, 7-9 and 10+. Universal
+// balls can clear smaller groups; those land in the first bucket.
+static constexpr int telemetryMatchTiers = 4;
+
+struct PhaseStats {
+    double totalMs = 0.0;
+    float maxMs = 0.0f;
+};
+
+// Fixed-size record handed from the game thread to the writer thread.
+struct TelemetryRecord {
+    TelemetryRecordType type;
+    uint32_t session;
+    float time;
+
+    int level;
+    bool levelMode;
+    uint64_t seed;
+    int64_t startedAt;
+
+    SimEventType event;
+    int score;
+    int balls;
+    int particles;
+    QualityLevel quality;
+
+    uint32_t frames;
+    int shots;
+    int peakParticles;
+    uint32_t dropped;
+    std::array<int, telemetryMatchTiers> matches;
+    std::array<uint32_t, telemetryFrameBuckets.size() + 1> frameHistogram;
+    std::array<PhaseStats, PHASE_COUNT> phases;
+    std::array<uint32_t, QUALITY_LEVEL_COUNT> qualityFrames;
+};
+
+// Appends per-session JSON lines to a local file. The game thread only
+// aggregates into fixed-size state and pushes records to a queue; a
+// background thread formats them and writes through a buffered stream, so
+// a slow disk never stalls a frame. Records that do not fit the queue are
+// dropped and counted in the session summary.
+class Telemetry {
+    static constexpr float sampleInterval = 1.0f;
+
+    SpscQueue<TelemetryRecord, 1024> queue;
+    std::FILE* file = nullptr;
+    std::thread writer;
+    std::atomic<bool> running{ false };
+
+    bool inSession = false;
+    uint32_t sessionId = 0;
+    TelemetryRecord current{};
+    float sessionTime = 0.0f;
+    float nextSample = 0.0f;
+
+    void submit(const TelemetryRecord& record);
+    void writeLoop();
+    void writeRecord(const TelemetryRecord& record);
+
+public:
+    Telemetry() = default;
+    Telemetry(const Telemetry&) = delete;
+    Telemetry& operator=(const Telemetry&) = delete;
+    ~Telemetry();
+
+    bool open(const char* path);
+    void close();
+
+    bool isOpen() const {
+        return file != nullptr;
+    }
+
+    bool isInSession() const {
+        return inSession;
+    }
+
+    void beginSession(int level, bool levelMode, uint64_t seed);
+    void endSession(int score);
+
+    void observe(const SimEvent& event, int score);
+    void frame(float frameSeconds, const std::array<float, PHASE_COUNT>& phaseMs, size_t balls,
+        size_t particles, int score, QualityLevel quality);
+};
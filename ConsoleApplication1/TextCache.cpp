@@ -0,0 +1,61 @@
+#include "TextCache.h"
+#include "SimCore.h"
+
+static size_t targetBytes(const RenderTexture2D& target) {
+    return static_cast<size_t>(target.texture.width) * static_cast<size_t>(target.texture.height) * 4;
+}
+
+void TextCache::rasterize(Entry& entry, const char* text) {
+    int textWidth = MeasureText(text, entry.fontSize);
+
+    // Targets only grow, so a counter that gains a digit reallocates once.
+    if (entry.target.id == 0 || textWidth > entry.target.texture.width) {
+        if (entry.target.id != 0) {
+            allocTracker.recordRelease(TAG_TEXTURES, targetBytes(entry.target));
+            UnloadRenderTexture(entry.target);
+        }
+
+        int capacity = (textWidth + 31) & ~31;
+        entry.target = LoadRenderTexture(capacity > 0 ? capacity : 32, entry.fontSize);
+        allocTracker.recordAllocation(TAG_TEXTURES, targetBytes(entry.target));
+    }
+
+    entry.width = textWidth;
+
+    BeginTextureMode(entry.target);
+    ClearBackground(BLANK);
+    DrawText(text, 0, 0, entry.fontSize, WHITE);
+    EndTextureMode();
+}
+
+TextCache::Handle TextCache::addStatic(const char* text, int fontSize) {
+    Handle handle = addDynamic(fontSize);
+    rasterize(entries.back(), text);
+    return handle;
+}
+
+TextCache::Handle TextCache::addDynamic(int fontSize) {
+    Entry entry{};
+    entry.fontSize = fontSize;
+    entries.push_back(entry);
+    return static_cast<Handle>(entries.size()) - 1;
+}
+
+void TextCache::draw(Handle handle, int x, int y, Color tint) const {
+    const Entry& entry = entries[static_cast<size_t>(handle)];
+    if (entry.target.id == 0) return;
+
+    // Render textures are stored bottom-up, hence the negative source height.
+    Rectangle source = { 0.0f, 0.0f, static_cast<float>(entry.width), -static_cast<float>(entry.fontSize) };
+    DrawTextureRec(entry.target.texture, source, { static_cast<float>(x), static_cast<float>(y) }, tint);
+}
+
+void TextCache::clear() {
+    for (Entry& entry : entries) {
+        if (entry.target.id != 0) {
+            allocTracker.recordRelease(TAG_TEXTURES, targetBytes(entry.target));
+            UnloadRenderTexture(entry.target);
+        }
+    }
+    entries.clear();
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "raylib.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Text rasterized into render textures. Static labels are rendered once when
+// they are added; dynamic labels are re-rendered only when their key changes,
+// so a steady frame draws text as plain textured quads without formatting or
+// glyph layout.
+class TextCache {
+    struct Entry {
+        RenderTexture2D target;
+        int fontSize;
+        int width;
+        uint64_t key;
+        bool hasKey;
+    };
+
+    std::vector<Entry> entries;
+
+    void rasterize(Entry& entry, const char* text);
+
+public:
+    using Handle = int;
+
+    TextCache() = default;
+    TextCache(const TextCache&) = delete;
+    TextCache& operator=(const TextCache&) = delete;
+
+    Handle addStatic(const char* text, int fontSize);
+    Handle addDynamic(int fontSize);
+
+    // Formats and re-renders only when `key` differs from the previous call.
+    template <typename... Args>
+    void update(Handle handle, uint64_t key, const char* format, Args... args) {
+        Entry& entry = entries[static_cast<size_t>(handle)];
+        if (entry.hasKey && entry.key == key) return;
+
+        entry.key = key;
+        entry.hasKey = true;
+        rasterize(entry, TextFormat(format, args...));
+    }
+
+    int width(Handle handle) const {
+        return entries[static_cast<size_t>(handle)].width;
+    }
+
+    void draw(Handle handle, int x, int y, Color tint) const;
+
+    void drawCentered(Handle handle, int centerX, int y, Color tint) const {
+        draw(handle, centerX - width(handle) / 2, y, tint);
+    }
+
+    void clear();
+};
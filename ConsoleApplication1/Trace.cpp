@@ -0,0 +1,200 @@
+#include "Trace.h"
+#include "Concurrency.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+std::atomic<bool> traceRunning{ false };
+
+using Clock = std::chrono::steady_clock;
+
+struct TraceEvent {
+    const char* name;
+    int64_t time;
+    int32_t values[2];
+    uint32_t tid;
+    char phase;
+};
+
+// Rings outlive their threads: when a thread exits its ring is retired and
+// handed to the next new thread once drained, so the short-lived board
+// workers do not pile up buffers.
+struct TraceBuffer {
+    SpscQueue<TraceEvent, 32768> events;
+    std::atomic<bool> retired{ false };
+};
+
+struct TraceThread {
+    TraceBuffer* buffer = nullptr;
+    const char* name = nullptr;
+    uint32_t tid = 0;
+    uint32_t epoch = 0;
+
+    ~TraceThread() {
+        if (buffer) buffer->retired.store(true, std::memory_order_release);
+    }
+};
+
+static std::mutex bufferMutex;
+static std::vector<std::unique_ptr<TraceBuffer>> buffers;
+static std::atomic<uint32_t> nextTid{ 1 };
+static std::atomic<uint32_t> traceEpoch{ 0 };
+static std::atomic<uint64_t> droppedEvents{ 0 };
+
+static std::FILE* traceFile = nullptr;
+static std::thread traceWriter;
+static std::atomic<bool> writerRunning{ false };
+static int64_t traceOrigin = 0;
+static bool firstEvent = true;
+
+static thread_local TraceThread traceThread;
+
+static int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+static TraceBuffer* attachBuffer() {
+    std::lock_guard<std::mutex> lock(bufferMutex);
+    for (std::unique_ptr<TraceBuffer>& buffer : buffers) {
+        if (buffer->retired.load(std::memory_order_acquire) && buffer->events.empty()) {
+            buffer->retired.store(false, std::memory_order_relaxed);
+            return buffer.get();
+        }
+    }
+    buffers.push_back(std::make_unique<TraceBuffer>());
+    return buffers.back().get();
+}
+
+static void push(const char* name, char phase, int32_t first = 0, int32_t second = 0) {
+    TraceThread& thread = traceThread;
+    if (!thread.buffer) {
+        thread.buffer = attachBuffer();
+        thread.tid = nextTid.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint32_t epoch = traceEpoch.load(std::memory_order_relaxed);
+    if (thread.epoch != epoch) {
+        thread.epoch = epoch;
+        TraceEvent meta = { thread.name ? thread.name : "thread", 0, { 0, 0 }, thread.tid, 'M' };
+        if (!thread.buffer->events.push(meta)) {
+            droppedEvents.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    TraceEvent event = { name, nowNs(), { first, second }, thread.tid, phase };
+    if (!thread.buffer->events.push(event)) {
+        droppedEvents.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+static void writeEvent(const TraceEvent& event) {
+    std::fputs(firstEvent ? "\n" : ",\n", traceFile);
+    firstEvent = false;
+
+    double us = static_cast<double>(event.time - traceOrigin) / 1000.0;
+    switch (event.phase) {
+    case 'M':
+        std::fprintf(traceFile, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+            event.tid, event.name);
+        break;
+    case 'C':
+        std::fprintf(traceFile, "{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,"
+            "\"args\":{\"balls\":%d,\"particles\":%d}}",
+            event.name, us, event.tid, event.values[0], event.values[1]);
+        break;
+    default:
+        std::fprintf(traceFile, "{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%u}",
+            event.name, event.phase, us, event.tid);
+        break;
+    }
+}
+
+// Drains every ring, returning whether anything was written. Stale events
+// from before traceStart() are dropped instead when `discard` is set. Only
+// the ring list is read under the lock, so a thread attaching its first
+// ring never waits on file IO; rings are never freed, so the copied
+// pointers stay valid.
+static bool drainBuffers(bool discard) {
+    static std::vector<TraceBuffer*> draining;
+    {
+        std::lock_guard<std::mutex> lock(bufferMutex);
+        draining.clear();
+        for (std::unique_ptr<TraceBuffer>& buffer : buffers) {
+            draining.push_back(buffer.get());
+        }
+    }
+
+    bool wrote = false;
+    TraceEvent event;
+    for (TraceBuffer* buffer : draining) {
+        while (buffer->events.pop(event)) {
+            if (!discard) writeEvent(event);
+            wrote = true;
+        }
+    }
+    return wrote;
+}
+
+static void writeLoop() {
+    for (;;) {
+        bool stopping = !writerRunning.load(std::memory_order_acquire);
+        if (drainBuffers(false)) continue;
+        if (stopping) break;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+}
+
+bool traceStart(const char* path) {
+    if (traceFile) return true;
+
+    traceFile = std::fopen(path, "wb");
+    if (!traceFile) return false;
+
+    std::setvbuf(traceFile, nullptr, _IOFBF, 64 * 1024);
+    std::fputs("{\"traceEvents\":[", traceFile);
+    firstEvent = true;
+    drainBuffers(true);
+    droppedEvents = 0;
+    traceOrigin = nowNs();
+    traceEpoch.fetch_add(1, std::memory_order_relaxed);
+
+    writerRunning = true;
+    traceWriter = std::thread(writeLoop);
+    traceRunning.store(true, std::memory_order_release);
+    return true;
+}
+
+void traceStop() {
+    if (!traceFile) return;
+
+    traceRunning.store(false, std::memory_order_release);
+    writerRunning = false;
+    traceWriter.join();
+
+    std::fprintf(traceFile, "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_events\":%llu}}\n",
+        static_cast<unsigned long long>(droppedEvents.load()));
+    std::fclose(traceFile);
+    traceFile = nullptr;
+}
+
+void traceBegin(const char* name) {
+    if (traceEnabled()) push(name, 'B');
+}
+
+void traceEnd(const char* name) {
+    if (traceEnabled()) push(name, 'E');
+}
+
+void traceCounters(int balls, int particles) {
+    if (traceEnabled()) push("counts", 'C', balls, particles);
+}
+
+void traceThreadName(const char* name) {
+    traceThread.name = name;
+    traceThread.epoch = 0;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+
+// Chrome trace-event recording, readable in chrome://tracing or
+// ui.perfetto.dev. Off unless traceStart() is called; until then every
+// call below costs one relaxed load. While on, each thread appends
+// fixed-size events to its own lock-free ring and a writer thread formats
+// them into the JSON file, so a traced thread never formats, allocates or
+// touches the file. Events that do not fit a ring are dropped and counted
+// at the end of the file. Names are stored as pointers and must be string
+// literals.
+extern std::atomic<bool> traceRunning;
+
+inline bool traceEnabled() {
+    return traceRunning.load(std::memory_order_relaxed);
+}
+
+bool traceStart(const char* path);
+void traceStop();
+
+void traceBegin(const char* name);
+void traceEnd(const char* name);
+void traceCounters(int balls, int particles);
+
+// Names the calling thread in the timeline. May be called before tracing
+// starts; the name is written whenever a trace is.
+void traceThreadName(const char* name);
+
+// Begin/end span around a scope. A span open when the trace stops is left
+// without its end, which the viewers close at the end of the timeline.
+class TraceScope {
+    const char* name;
+    bool active;
+
+public:
+    explicit TraceScope(const char* scopeName) : name(scopeName), active(traceEnabled()) {
+        if (active) traceBegin(name);
+    }
+
+    ~TraceScope() {
+        if (active) traceEnd(name);
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+};
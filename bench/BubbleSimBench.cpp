@@ -0,0 +1,179 @@
+#include "BoardGenerator.h"
+#include "BotSession.h"
+#include "BubbleSim.h"
+#include "Trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchOptions {
+    int ticks = 3000;
+    uint64_t seed = 12345;
+    bool csv = false;
+    ClusterSolver solver = SOLVER_SPRINGS;
+    int solverIterations = 4;
+    uint32_t reorderInterval = 300;
+    std::string tracePath;
+};
+
+static double elapsedMicroseconds(Clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+static SimConfig benchConfig(const BenchOptions& options) {
+    SimConfig config;
+    config.seed = options.seed;
+    config.solver = options.solver;
+    config.solverIterations = options.solverIterations;
+    config.reorderInterval = options.reorderInterval;
+    return config;
+}
+
+static void benchSession(const char* name, int level, const BenchOptions& options) {
+    SimConfig config = benchConfig(options);
+    BubbleSim sim(config);
+    BotSession bot(level, options.seed);
+
+    std::vector<double> tickTimes;
+    tickTimes.reserve(static_cast<size_t>(options.ticks));
+    size_t peakBalls = 0;
+
+    for (int i = 0; i < options.ticks; i++) {
+        InputState input = bot.next(sim);
+        Clock::time_point start = Clock::now();
+        sim.tick(input, 1.0f / 60.0f);
+        tickTimes.push_back(elapsedMicroseconds(start));
+        peakBalls = std::max(peakBalls, sim.getBallCount());
+    }
+
+    double total = 0.0;
+    for (double time : tickTimes) {
+        total += time;
+    }
+    std::sort(tickTimes.begin(), tickTimes.end());
+
+    const char* format = options.csv ? "%s,%.2f,%.2f,%.2f,%zu\n" : "%-18s %10.2f %10.2f %10.2f %8zu\n";
+    std::printf(format, name, total / tickTimes.size(),
+        tickTimes[tickTimes.size() / 2], tickTimes[tickTimes.size() * 99 / 100], peakBalls);
+}
+
+static void benchSaveState(const BenchOptions& options) {
+    SimConfig config = benchConfig(options);
+    BubbleSim sim(config);
+    BotSession bot(0, options.seed);
+    for (int i = 0; i < 600; i++) {
+        sim.tick(bot.next(sim), 1.0f / 60.0f);
+    }
+
+    const int rounds = 1000;
+    std::vector<uint8_t> bytes;
+
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < rounds; i++) {
+        sim.saveState(bytes, true);
+    }
+    double saveTime = elapsedMicroseconds(start) / rounds;
+
+    start = Clock::now();
+    for (int i = 0; i < rounds; i++) {
+        sim.loadState(bytes.data(), bytes.size());
+    }
+    double loadTime = elapsedMicroseconds(start) / rounds;
+
+    std::printf("\nsave state: %zu bytes, save %.2f us, load %.2f us\n", bytes.size(), saveTime, loadTime);
+}
+
+static void benchBoards(const char* name, const BoardSpec& spec, const BenchOptions& options) {
+    BoardGenerator generator;
+    SimRng rng(options.seed);
+    std::pmr::monotonic_buffer_resource arena;
+    ColorGrid grid(spec.rows, spec.columns, &arena);
+
+    const int boards = 200000;
+    uint32_t checksum = 0;
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < boards; i++) {
+        generator.generate(spec, rng, grid);
+        checksum += grid.cells[static_cast<size_t>(i) % grid.cells.size()];
+    }
+    double seconds = elapsedMicroseconds(start) / 1e6;
+
+    std::printf("boards %-11s %10.0f boards/s %8.1f ns/cell (checksum %u)\n", name, boards / seconds,
+        seconds * 1e9 / (static_cast<double>(boards) * grid.cells.size()), checksum);
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg.rfind("--ticks=", 0) == 0) {
+            options.ticks = std::max(1, std::atoi(arg.c_str() + 8));
+        }
+        else if (arg.rfind("--seed=", 0) == 0) {
+            options.seed = std::strtoull(arg.c_str() + 7, nullptr, 10);
+        }
+        else if (arg == "--csv") {
+            options.csv = true;
+        }
+        else if (arg == "--solver=pbd") {
+            options.solver = SOLVER_PBD;
+        }
+        else if (arg.rfind("--solver-iterations=", 0) == 0) {
+            options.solverIterations = std::max(1, std::atoi(arg.c_str() + 20));
+        }
+        else if (arg.rfind("--reorder-interval=", 0) == 0) {
+            options.reorderInterval = static_cast<uint32_t>(std::max(0, std::atoi(arg.c_str() + 19)));
+        }
+        else if (arg.rfind("--trace=", 0) == 0) {
+            options.tracePath = arg.substr(8);
+        }
+    }
+
+    if (!options.tracePath.empty() && !traceStart(options.tracePath.c_str())) {
+        std::printf("cannot open %s\n", options.tracePath.c_str());
+        return 1;
+    }
+
+    if (options.csv) {
+        std::printf("session,mean_us,p50_us,p99_us,balls\n");
+    }
+    else {
+        std::printf("%-18s %10s %10s %10s %8s\n", "session", "mean us", "p50 us", "p99 us", "balls");
+    }
+
+    benchSession("endless", 0, options);
+
+    SimConfig config;
+    BubbleSim levels(config);
+    for (const Level& level : levels.getLevels()) {
+        benchSession(level.name, level.levelNumber, options);
+    }
+
+    if (!options.csv) {
+        benchSaveState(options);
+
+        std::printf("\n");
+        BoardSpec endless;
+        benchBoards("endless", endless, options);
+
+        BoardSpec fewColors;
+        fewColors.colorCount = 4;
+        fewColors.maxGroup = 2;
+        benchBoards("4 colours", fewColors, options);
+
+        BoardSpec withSpecials;
+        withSpecials.specialPercent = 20;
+        withSpecials.allowBomb = true;
+        withSpecials.allowRainbow = true;
+        benchBoards("specials", withSpecials, options);
+    }
+    traceStop();
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include "BotSession.h"
+#include "BubbleSim.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// Training workload for profile-guided builds. Replays seeded bot sessions
+// on endless mode and on every level in levelTable, with the odd
+// undo, rewind and save-state round trip so those paths are profiled too.
+// The benchmark uses a different seed, so the profile is not scored on the
+// sessions it was trained on.
+
+struct TrainingOptions {
+    int sessions = 4;
+    int ticks = 2400;
+};
+
+static void trainSession(int level, uint64_t seed, const TrainingOptions& options) {
+    SimConfig config;
+    config.seed = seed;
+    BubbleSim sim(config);
+    BotSession bot(level, seed);
+    std::vector<uint8_t> saved;
+
+    for (int i = 1; i <= options.ticks; i++) {
+        InputState input = bot.next(sim);
+        if (i % 600 == 0) {
+            input.undoShotPressed = true;
+        }
+        else if (i % 900 == 0) {
+            input.rewindPressed = true;
+        }
+        sim.tick(input, 1.0f / 60.0f);
+
+        if (i % 300 == 0) {
+            sim.saveState(saved, true);
+            sim.loadState(saved.data(), saved.size());
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    TrainingOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg.rfind("--sessions=", 0) == 0) {
+            options.sessions = std::max(1, std::atoi(arg.c_str() + 11));
+        }
+        else if (arg.rfind("--ticks=", 0) == 0) {
+            options.ticks = std::max(1, std::atoi(arg.c_str() + 8));
+        }
+    }
+
+    SimConfig config;
+    BubbleSim levels(config);
+    int levelCount = static_cast<int>(levels.getLevels().size());
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int level = 0; level <= levelCount; level++) {
+        for (int session = 1; session <= options.sessions; session++) {
+            trainSession(level, static_cast<uint64_t>(level * 1000 + session), options);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("Trained %d sessions of %d ticks on endless + %d levels in %.1f s\n",
+        options.sessions * (levelCount + 1), options.ticks, levelCount, seconds);
+    return 0;
+}
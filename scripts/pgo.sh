@@ -0,0 +1,51 @@
+#!/usr/bin/env sh
+# Profile-guided build of the headless simulation.
+#
+#   1. builds the instrumented pgo-generate preset and runs the training replays,
+#   2. builds pgo-use from the collected profile and the plain fleet preset,
+#   3. benchmarks both and writes build/pgo-report.txt with the per-session gain.
+#
+# Usage: scripts/pgo.sh [training sessions per level] [benchmark ticks]
+set -e
+
+cd "$(dirname "$0")/.."
+
+SESSIONS=${1:-4}
+TICKS=${2:-3000}
+PROFILE_DIR=build/pgo-profile
+JOBS=$(nproc 2>/dev/null || echo 4)
+
+rm -rf "$PROFILE_DIR"
+
+cmake --preset pgo-generate
+cmake --build --preset pgo-generate --target bubble_sim_train -j "$JOBS"
+build/pgo-generate/bubble_sim_train --sessions="$SESSIONS"
+
+if ls "$PROFILE_DIR"/*.profraw >/dev/null 2>&1; then
+    llvm-profdata merge -o "$PROFILE_DIR/bubble.profdata" "$PROFILE_DIR"/*.profraw
+fi
+
+cmake --preset pgo-use
+cmake --build --preset pgo-use --target bubble_sim_bench -j "$JOBS"
+cmake --preset fleet
+cmake --build --preset fleet --target bubble_sim_bench -j "$JOBS"
+
+build/fleet/bubble_sim_bench --csv --ticks="$TICKS" > build/pgo-baseline.csv
+build/pgo-use/bubble_sim_bench --csv --ticks="$TICKS" > build/pgo-optimized.csv
+
+awk -F, '
+    FNR == 1 { next }
+    NR == FNR { base[$1] = $2; baseP99[$1] = $4; order[++count] = $1; next }
+    { pgo[$1] = $2; pgoP99[$1] = $4 }
+    END {
+        printf "%-18s %12s %12s %8s %12s %12s %8s\n", "session", "base mean", "pgo mean", "gain", "base p99", "pgo p99", "gain"
+        for (i = 1; i <= count; i++) {
+            s = order[i]
+            printf "%-18s %10.2fus %10.2fus %7.1f%% %10.2fus %10.2fus %7.1f%%\n", s,
+                base[s], pgo[s], (base[s] - pgo[s]) / base[s] * 100,
+                baseP99[s], pgoP99[s], (baseP99[s] - pgoP99[s]) / baseP99[s] * 100
+            totalBase += base[s]
+            totalPgo += pgo[s]
+        }
+        printf "%-18s %10.2fus %10.2fus %7.1f%%\n", "all sessions", totalBase, totalPgo, (totalBase - totalPgo) / totalBase * 100
+    }' build/pgo-baseline.csv build/pgo-optimized.csv | tee build/pgo-report.txt
@@ -0,0 +1,876 @@
+#include "AudioEngine.h"
+#include "BoardGenerator.h"
+#include "BotSession.h"
+#include "BubbleSim.h"
+#include "ColorMatch.h"
+#include "Concurrency.h"
+#include "FramePacer.h"
+#include "InputLatency.h"
+#include "QualityController.h"
+#include "Telemetry.h"
+#include "Trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+static SimConfig testConfig(uint64_t seed) {
+    SimConfig config;
+    config.seed = seed;
+    return config;
+}
+
+static void play(BubbleSim& sim, BotSession& bot, int ticks) {
+    for (int i = 0; i < ticks; i++) {
+        sim.tick(bot.next(sim), 1.0f / 60.0f);
+    }
+}
+
+static void testStartLevel() {
+    BubbleSim sim(testConfig(1));
+    CHECK(sim.getGameState() == MAIN_MENU);
+
+    InputState input{};
+    input.command = COMMAND_START_LEVEL;
+    input.commandLevel = 2;
+    sim.tick(input, 1.0f / 60.0f);
+
+    CHECK(sim.getGameState() == PLAYING);
+    CHECK(sim.getCurrentLevel() == 2);
+    CHECK(sim.getBallCount() == static_cast<size_t>(sim.getLevels()[1].ballCount));
+    CHECK(sim.isWaitingToShoot());
+}
+
+static void testSaveStateRoundTrip() {
+    BubbleSim sim(testConfig(2));
+    BotSession bot(0, 2);
+    play(sim, bot, 600);
+
+    std::vector<uint8_t> saved;
+    sim.saveState(saved, true);
+
+    BubbleSim restored(testConfig(99));
+    CHECK(restored.loadState(saved.data(), saved.size()));
+
+    std::vector<uint8_t> resaved;
+    restored.saveState(resaved, true);
+    CHECK(saved == resaved);
+    CHECK(restored.getScore() == sim.getScore());
+    CHECK(restored.getBallCount() == sim.getBallCount());
+}
+
+static void testRestoredSessionsStayInLockstep() {
+    BubbleSim sim(testConfig(3));
+    BotSession bot(3, 3);
+    play(sim, bot, 300);
+
+    std::vector<uint8_t> saved;
+    sim.saveState(saved, false);
+
+    BubbleSim first(testConfig(4));
+    BubbleSim second(testConfig(5));
+    CHECK(first.loadState(saved.data(), saved.size()));
+    CHECK(second.loadState(saved.data(), saved.size()));
+
+    BotSession firstBot(3, 7);
+    BotSession secondBot(3, 7);
+    play(first, firstBot, 400);
+    play(second, secondBot, 400);
+
+    std::vector<uint8_t> a;
+    std::vector<uint8_t> b;
+    first.saveState(a, false);
+    second.saveState(b, false);
+    CHECK(a == b);
+}
+
+static void testRejectsCorruptState() {
+    BubbleSim sim(testConfig(6));
+    BotSession bot(1, 6);
+    play(sim, bot, 120);
+
+    std::vector<uint8_t> saved;
+    sim.saveState(saved, false);
+
+    std::vector<uint8_t> truncated(saved.begin(), saved.end() - 1);
+    CHECK(!sim.loadState(truncated.data(), truncated.size()));
+
+    std::vector<uint8_t> badMagic = saved;
+    badMagic[0] = 'X';
+    CHECK(!sim.loadState(badMagic.data(), badMagic.size()));
+
+    CHECK(sim.loadState(saved.data(), saved.size()));
+}
+
+static void testRewindReconstructsPastTicks() {
+    SimConfig config = testConfig(8);
+    config.rewindKeyframeInterval = 30;
+    BubbleSim sim(config);
+    BotSession bot(2, 8);
+    play(sim, bot, 100);
+
+    uint32_t markTick = sim.getSimTick();
+    std::vector<uint8_t> atMark;
+    sim.saveState(atMark, false);
+
+    play(sim, bot, 150);
+    CHECK(sim.getRewind().oldestTick() <= markTick);
+
+    CHECK(sim.rewindTo(markTick));
+    CHECK(sim.getSimTick() == markTick);
+
+    std::vector<uint8_t> rewound;
+    sim.saveState(rewound, false);
+    CHECK(rewound == atMark);
+}
+
+static void testRewindStaysWithinBudget() {
+    SimConfig config = testConfig(8);
+    config.rewindBudgetBytes = 16 * 1024;
+    config.rewindKeyframeInterval = 100000;
+    BubbleSim sim(config);
+    BotSession bot(2, 8);
+
+    // A segment that outgrows the budget is closed at the next tick, so
+    // the history can only be over budget for one tick at a time.
+    int overBudgetRun = 0;
+    int longestOverBudgetRun = 0;
+    for (int i = 0; i < 600; i++) {
+        sim.tick(bot.next(sim), 1.0f / 60.0f);
+        overBudgetRun = sim.getRewind().memoryUsed() > config.rewindBudgetBytes ? overBudgetRun + 1 : 0;
+        longestOverBudgetRun = std::max(longestOverBudgetRun, overBudgetRun);
+    }
+
+    CHECK(longestOverBudgetRun <= 1);
+    CHECK(sim.getRewind().oldestTick() > 0);
+    CHECK(sim.rewindTo(sim.getRewind().oldestTick()));
+}
+
+static int playShots(BubbleSim& sim, BotSession& bot, int shots) {
+    int fired = 0;
+    for (int i = 0; i < 20000 && fired < shots; i++) {
+        sim.tick(bot.next(sim), 1.0f / 60.0f);
+        for (const SimEvent& event : sim.getEvents()) {
+            if (event.type == EVENT_SHOT) fired++;
+        }
+    }
+    return fired;
+}
+
+// Counts undo presses that stepped back, out of `presses`.
+static int pressUndo(BubbleSim& sim, int presses) {
+    InputState undo{};
+    undo.undoShotPressed = true;
+    int undone = 0;
+    for (int i = 0; i < presses; i++) {
+        uint32_t before = sim.getSimTick();
+        sim.tick(undo, 1.0f / 60.0f);
+        if (sim.getSimTick() <= before) undone++;
+    }
+    return undone;
+}
+
+static void testUndoKeepsRecentShots() {
+    SimConfig config = testConfig(8);
+    config.rewindBudgetBytes = 16 * 1024 * 1024;
+    config.rewindKeyframeInterval = 30;
+    BubbleSim sim(config);
+    BotSession bot(0, 8);
+
+    // Only the last 16 shots are remembered: 24 shots leave 16, undoing 10
+    // leaves 6, and 6 more shots make 12 to step back through.
+    CHECK(playShots(sim, bot, 24) == 24);
+    CHECK(pressUndo(sim, 10) == 10);
+    CHECK(playShots(sim, bot, 6) == 6);
+    CHECK(sim.getGameState() == PLAYING);
+    CHECK(pressUndo(sim, 20) == 12);
+
+    CHECK(playShots(sim, bot, 1) == 1);
+    CHECK(pressUndo(sim, 3) == 1);
+}
+
+static void testEventsDriveScoring() {
+    BubbleSim sim(testConfig(11));
+    SimConfig quietConfig = testConfig(11);
+    quietConfig.effects = false;
+    BubbleSim quiet(quietConfig);
+
+    BotSession bot(1, 11);
+    BotSession quietBot(1, 11);
+    int shots = 0;
+    int unexplainedScoreChanges = 0;
+
+    for (int i = 0; i < 1500; i++) {
+        int before = sim.getScore();
+        sim.tick(bot.next(sim), 1.0f / 60.0f);
+        quiet.tick(quietBot.next(quiet), 1.0f / 60.0f);
+
+        bool scored = false;
+        bool levelChanged = false;
+        for (const SimEvent& event : sim.getEvents()) {
+            if (event.type == EVENT_SHOT) shots++;
+            if (event.type == EVENT_MATCH || event.type == EVENT_BOMB || event.type == EVENT_RAINBOW) scored = true;
+            if (event.type == EVENT_LEVEL_COMPLETE) levelChanged = true;
+        }
+        if (sim.getScore() != before && !scored && !levelChanged) unexplainedScoreChanges++;
+    }
+
+    CHECK(shots > 0);
+    CHECK(unexplainedScoreChanges == 0);
+    CHECK(quiet.getParticleCount() == 0);
+    CHECK(quiet.getScore() == sim.getScore());
+    CHECK(quiet.getBallCount() == sim.getBallCount());
+}
+
+static SimEvent popEvent() {
+    return { EVENT_POP, EVENT_MATCH, NORMAL, { 0.0f, 0.0f }, RED, 1 };
+}
+
+static void testAudioCascadeUsesFixedVoices() {
+    NullAudioBackend backend;
+    AudioEngine audio;
+    CHECK(audio.init(backend));
+    CHECK(backend.loads == CUE_COUNT);
+
+    for (int i = 0; i < 30; i++) {
+        audio.queue(popEvent());
+    }
+    audio.update();
+
+    CHECK(backend.cues[CUE_POP].plays == 3);
+    CHECK(audio.getStats().coalesced == 27);
+
+    // Back-to-back cascades run out of free voices and steal the oldest.
+    for (int frame = 0; frame < 4; frame++) {
+        for (int i = 0; i < 30; i++) {
+            audio.queue(popEvent());
+        }
+        audio.update();
+    }
+    CHECK(audio.getStats().stolen > 0);
+    CHECK(backend.cues[CUE_POP].peakActive <= AudioEngine::voicesFor(CUE_POP));
+
+    audio.shutdown();
+    CHECK(!audio.isReady());
+}
+
+static void testAudioFollowsSimEvents() {
+    NullAudioBackend backend;
+    AudioEngine audio;
+    CHECK(audio.init(backend));
+
+    BubbleSim sim(testConfig(12));
+    BotSession bot(0, 12);
+    for (int i = 0; i < 3000; i++) {
+        sim.tick(bot.next(sim), 1.0f / 60.0f);
+        for (const SimEvent& event : sim.getEvents()) {
+            audio.queue(event);
+        }
+        audio.update();
+    }
+
+    CHECK(audio.getStats().triggers > 0);
+    for (int cue = 0; cue < CUE_COUNT; cue++) {
+        CHECK(backend.cues[static_cast<size_t>(cue)].peakActive <= AudioEngine::voicesFor(static_cast<SoundCue>(cue)));
+    }
+}
+
+static void testTelemetryWritesSessionRecords() {
+    const char* path = "telemetry_test.jsonl";
+    std::remove(path);
+
+    Telemetry telemetry;
+    CHECK(telemetry.open(path));
+
+    BubbleSim sim(testConfig(13));
+    BotSession bot(2, 13);
+    std::array<float, PHASE_COUNT> phases = { 0.1f, 0.5f, 2.0f };
+
+    for (int i = 0; i < 900; i++) {
+        sim.tick(bot.next(sim), 1.0f / 60.0f);
+        if (sim.getGameState() == PLAYING && !telemetry.isInSession()) {
+            telemetry.beginSession(sim.getCurrentLevel(), true, 13);
+        }
+        for (const SimEvent& event : sim.getEvents()) {
+            telemetry.observe(event, sim.getScore());
+        }
+        telemetry.frame(i % 10 == 0 ? 0.040f : 0.016f, phases, sim.getBallCount(), sim.getParticleCount(),
+            sim.getScore(), i < 600 ? QUALITY_FULL : QUALITY_NO_CONNECTIONS);
+    }
+    telemetry.close();
+
+    std::FILE* file = std::fopen(path, "rb");
+    CHECK(file != nullptr);
+    if (!file) return;
+
+    int starts = 0;
+    int samples = 0;
+    int ends = 0;
+    std::string summary;
+    char line[2048];
+    while (std::fgets(line, sizeof(line), file)) {
+        if (std::strstr(line, "\"type\":\"session_start\"")) starts++;
+        if (std::strstr(line, "\"type\":\"sample\"")) samples++;
+        if (std::strstr(line, "\"type\":\"session_end\"")) {
+            ends++;
+            summary = line;
+        }
+    }
+    std::fclose(file);
+    std::remove(path);
+
+    CHECK(starts == 1);
+    CHECK(ends == 1);
+    CHECK(samples >= 14);
+    CHECK(summary.find("\"frames\":900") != std::string::npos);
+    CHECK(summary.find("\"<16.7\":810") != std::string::npos);
+    CHECK(summary.find("\"<50\":90") != std::string::npos);
+    CHECK(summary.find("\"matches\":{") != std::string::npos);
+    CHECK(summary.find("\"quality_frames\":{\"full\":600,\"fewer_particles\":0,\"no_connections\":300") !=
+        std::string::npos);
+}
+
+static void testTraceWritesBalancedSpans() {
+    const char* path = "trace_test.json";
+    std::remove(path);
+
+    BubbleSim sim(testConfig(17));
+    BotSession bot(1, 17);
+    sim.tick(bot.next(sim), 1.0f / 60.0f);
+
+    CHECK(traceStart(path));
+    traceThreadName("test");
+    for (int i = 0; i < 300; i++) {
+        sim.tick(bot.next(sim), 1.0f / 60.0f);
+    }
+    traceStop();
+
+    std::FILE* file = std::fopen(path, "rb");
+    CHECK(file != nullptr);
+    if (!file) return;
+
+    int begins = 0;
+    int ends = 0;
+    int counters = 0;
+    int groupChecks = 0;
+    bool named = false;
+    std::string last;
+    char line[512];
+    while (std::fgets(line, sizeof(line), file)) {
+        if (std::strstr(line, "\"ph\":\"B\"")) begins++;
+        if (std::strstr(line, "\"ph\":\"E\"")) ends++;
+        if (std::strstr(line, "\"ph\":\"C\"")) counters++;
+        if (std::strstr(line, "\"name\":\"checkBallGroups\",\"ph\":\"B\"")) groupChecks++;
+        if (std::strstr(line, "\"args\":{\"name\":\"test\"}")) named = true;
+        last = line;
+    }
+    std::fclose(file);
+    std::remove(path);
+
+    CHECK(begins > 300);
+    CHECK(begins == ends);
+    CHECK(counters == 300);
+    CHECK(groupChecks > 0);
+    CHECK(named);
+    CHECK(last.find("\"dropped_events\":0}}") != std::string::npos);
+}
+
+static void testInputLatencyClosesOnPresent() {
+    using Clock = InputLatency::Clock;
+    Clock::time_point start = Clock::now();
+    auto at = [start](int ms) { return start + std::chrono::milliseconds(ms); };
+
+    InputLatency latency;
+    latency.sampled(1, false, at(0));
+    latency.sampled(2, true, at(2));
+    latency.sampled(3, false, at(4));
+
+    // The latch shows move 3, but the click waits for the simulation.
+    latency.presented(1, 3, at(10));
+    CHECK(latency.summary().count == 2);
+
+    latency.presented(2, 3, at(20));
+    LatencySummary summary = latency.summary();
+    CHECK(summary.count == 3);
+    CHECK(std::fabs(summary.maxMs - 18.0f) < 0.01f);
+    CHECK(std::fabs(summary.meanMs - (10.0 + 6.0 + 18.0) / 3.0) < 0.01);
+    CHECK(summary.p50Ms > 9.9f && summary.p50Ms <= 10.25f);
+
+    BubbleSim sim(testConfig(19));
+    sim.startEndless();
+    InputState input{};
+    input.mousePosition = { 100.0f, 400.0f };
+    input.serial = 42;
+    sim.tick(input, 1.0f / 60.0f);
+    RenderSnapshot view;
+    sim.fillSnapshot(view);
+    CHECK(view.inputSerial == 42);
+}
+
+static void testFramePacerHoldsRate() {
+    FramePacer pacer;
+    pacer.setRate(250.0);
+    CHECK(pacer.isCapped());
+
+    FramePacer::Clock::time_point start = FramePacer::Clock::now();
+    for (int i = 0; i < 51; i++) {
+        pacer.wait();
+    }
+    double elapsedMs = std::chrono::duration<double, std::milli>(FramePacer::Clock::now() - start).count();
+
+    // Wall time is only bounded below; a busy machine may preempt the test.
+    FrameStats stats = pacer.stats();
+    CHECK(stats.frames == 50);
+    CHECK(elapsedMs >= 199.0);
+    CHECK(stats.meanMs >= 3.99);
+    CHECK(stats.minMs <= stats.meanMs && stats.meanMs <= stats.maxMs);
+
+    // An unpaced gap is neither a miss nor a frame once the schedule restarts.
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    pacer.restart();
+    pacer.wait();
+    CHECK(pacer.stats().missed == stats.missed);
+    CHECK(pacer.stats().frames == stats.frames);
+
+    pacer.setRate(0.0);
+    pacer.resetStats();
+    CHECK(!pacer.isCapped());
+    for (int i = 0; i < 1000; i++) {
+        pacer.wait();
+    }
+    CHECK(pacer.stats().frames == 999);
+    CHECK(pacer.stats().missed == 0);
+}
+
+static void testQualityStepsWithFrameTime() {
+    QualityController quality;
+    quality.setBudget(10.0f);
+
+    for (int i = 0; i < 30; i++) {
+        quality.update(5.0f);
+    }
+    CHECK(quality.getLevel() == QUALITY_FULL);
+
+    // One spike is smoothed away; sustained overload steps down one level
+    // at a time, waiting for the average between steps.
+    quality.update(40.0f);
+    CHECK(quality.getLevel() == QUALITY_FULL);
+    for (int i = 0; i < 15; i++) {
+        quality.update(20.0f);
+    }
+    CHECK(quality.getLevel() == QUALITY_FEWER_PARTICLES);
+    for (int i = 0; i < 200; i++) {
+        quality.update(20.0f);
+    }
+    CHECK(quality.getLevel() == QUALITY_NO_OUTLINES);
+
+    // Just under budget holds the level; clear headroom restores it.
+    for (int i = 0; i < 300; i++) {
+        quality.update(9.0f);
+    }
+    CHECK(quality.getLevel() == QUALITY_NO_OUTLINES);
+    for (int i = 0; i < 150; i++) {
+        quality.update(3.0f);
+    }
+    CHECK(quality.getLevel() == QUALITY_LOW_SEGMENTS);
+    for (int i = 0; i < 600; i++) {
+        quality.update(3.0f);
+    }
+    CHECK(quality.getLevel() == QUALITY_FULL);
+
+    quality.pin(QUALITY_NO_CONNECTIONS);
+    for (int i = 0; i < 200; i++) {
+        quality.update(50.0f);
+    }
+    CHECK(quality.getLevel() == QUALITY_NO_CONNECTIONS);
+    CHECK(!quality.settings().connections);
+
+    // Fewer particles per explosion, same board.
+    BubbleSim full(testConfig(1));
+    BubbleSim reduced(testConfig(1));
+    reduced.setParticlePercent(qualityTable[QUALITY_NO_OUTLINES].particlePercent);
+    BotSession fullBot(0, 1);
+    BotSession reducedBot(0, 1);
+    size_t fullParticles = 0;
+    size_t reducedParticles = 0;
+    for (int i = 0; i < 900; i++) {
+        full.tick(fullBot.next(full), 1.0f / 60.0f);
+        reduced.tick(reducedBot.next(reduced), 1.0f / 60.0f);
+        fullParticles += full.getParticleCount();
+        reducedParticles += reduced.getParticleCount();
+    }
+    CHECK(full.getScore() == reduced.getScore());
+    CHECK(full.getBallCount() == reduced.getBallCount());
+    CHECK(fullParticles > 0);
+    CHECK(reducedParticles * 2 < fullParticles);
+}
+
+static void testColorKernelsMatchScalar() {
+    SimRng keyRng(21);
+    const BallColor samples[] = { 0, 1, 5, 9, colorBomb, colorIgnore, colorUniversalFlag,
+        colorRainbowFlag | 2, colorRainbowFlag | 5 };
+
+    for (int round = 0; round < 200; round++) {
+        uint8_t keys[colorBatch];
+        for (size_t i = 0; i < colorBatch; i++) {
+            keys[i] = samples[keyRng() % (sizeof(samples) / sizeof(samples[0]))];
+        }
+        BallColor target = static_cast<BallColor>(keyRng() % 10);
+
+        uint32_t exact = 0;
+        uint32_t orWild = 0;
+        uint32_t any = 0;
+        for (size_t i = 0; i < colorBatch; i++) {
+            if (keys[i] == target) exact |= 1u << i;
+            if (keys[i] == target || (keys[i] & colorWildMask)) orWild |= 1u << i;
+            if (keys[i] != colorIgnore) any |= 1u << i;
+        }
+
+        CHECK(matchColorExact(keys, target) == exact);
+        CHECK(matchColorOrWild(keys, target) == orWild);
+        CHECK(matchAnyColor(keys) == any);
+    }
+
+    CHECK(paddedColorCount(0) == 0);
+    CHECK(paddedColorCount(17) == 32);
+    CHECK(paletteColor(colorUniversalFlag).g == WHITE.g);
+    CHECK(paletteColor(colorBomb).r == BLACK.r);
+    CHECK(paletteColor(colorRainbowFlag | 1).b == BLUE.b);
+}
+
+static ColorCounts countColors(const BubbleSim& sim) {
+    std::vector<uint8_t> state;
+    sim.saveState(state, false);
+
+    SaveStateHeader header;
+    std::memcpy(&header, state.data(), sizeof(header));
+    size_t offset = sizeof(header) + ((header.flags & saveHasProjectile) ? sizeof(PackedBall) : 0);
+
+    ColorCounts counts{};
+    for (uint32_t i = 0; i < header.ballCount; i++) {
+        PackedBall packed;
+        std::memcpy(&packed, state.data() + offset + i * sizeof(PackedBall), sizeof(packed));
+        if (packed.paletteIndex < ballPalette.size()) counts[packed.paletteIndex]++;
+    }
+    return counts;
+}
+
+static void testColorCountsFollowTheBoard() {
+    for (int level = 0; level <= 5; level += 5) {
+        BubbleSim sim(testConfig(14));
+        BotSession bot(level, 14);
+        int mismatches = 0;
+
+        for (int i = 0; i < 2000; i++) {
+            sim.tick(bot.next(sim), 1.0f / 60.0f);
+            if (sim.getColorCounts() != countColors(sim)) mismatches++;
+        }
+        CHECK(mismatches == 0);
+    }
+}
+
+static void testReorderKeepsRewindAndCounts() {
+    SimConfig config = testConfig(16);
+    config.reorderInterval = 25;
+    config.rewindKeyframeInterval = 1000;
+    BubbleSim sim(config);
+    BotSession bot(4, 16);
+    play(sim, bot, 140);
+
+    uint32_t markTick = sim.getSimTick();
+    std::vector<uint8_t> atMark;
+    sim.saveState(atMark, false);
+
+    int mismatches = 0;
+    for (int i = 0; i < 90; i++) {
+        sim.tick(bot.next(sim), 1.0f / 60.0f);
+        if (sim.getColorCounts() != countColors(sim)) mismatches++;
+    }
+    CHECK(mismatches == 0);
+
+    CHECK(sim.rewindTo(markTick));
+    std::vector<uint8_t> rewound;
+    sim.saveState(rewound, false);
+    CHECK(rewound == atMark);
+}
+
+// Largest 4-connected run of one plain colour in the generated grid.
+static int largestGroup(const BoardSpec& spec, const ColorGrid& grid) {
+    std::vector<bool> seen(grid.cells.size(), false);
+    std::vector<int> stack;
+    int largest = 0;
+
+    for (size_t start = 0; start < grid.cells.size(); start++) {
+        if (seen[start] || ballTypeOf(grid.cells[start]) != NORMAL) continue;
+
+        int size = 0;
+        seen[start] = true;
+        stack.push_back(static_cast<int>(start));
+        while (!stack.empty()) {
+            int cell = stack.back();
+            stack.pop_back();
+            size++;
+
+            int row = cell / spec.columns;
+            int col = cell % spec.columns;
+            const int neighbours[4][2] = { { row, col - 1 }, { row, col + 1 }, { row - 1, col }, { row + 1, col } };
+            for (const auto& next : neighbours) {
+                if (next[0] < 0 || next[0] >= spec.rows || next[1] < 0 || next[1] >= spec.columns) continue;
+                size_t index = static_cast<size_t>(next[0] * spec.columns + next[1]);
+                if (!seen[index] && grid.cells[index] == grid.cells[start]) {
+                    seen[index] = true;
+                    stack.push_back(static_cast<int>(index));
+                }
+            }
+        }
+        largest = std::max(largest, size);
+    }
+    return largest;
+}
+
+static void testBoardsHaveNoOpeningMatches() {
+    BoardGenerator generator;
+    SimRng rng(17);
+    std::pmr::monotonic_buffer_resource arena;
+
+    int oversized = 0;
+    int badColors = 0;
+    int specials = 0;
+    int cells = 0;
+    for (int colorCount = 3; colorCount <= 10; colorCount++) {
+        for (int maxGroup = 1; maxGroup <= 3; maxGroup++) {
+            for (int board = 0; board < 50; board++) {
+                BoardSpec spec;
+                spec.rows = 10;
+                spec.columns = 14;
+                spec.colorCount = colorCount;
+                spec.maxGroup = maxGroup;
+                spec.specialPercent = 10;
+                spec.allowBomb = true;
+
+                ColorGrid grid(spec.rows, spec.columns, &arena);
+                CHECK(generator.generate(spec, rng, grid));
+                if (largestGroup(spec, grid) > maxGroup) oversized++;
+
+                for (BallColor color : grid.cells) {
+                    if (color == colorBomb) specials++;
+                    else if (color >= colorCount) badColors++;
+                }
+                cells += static_cast<int>(grid.cells.size());
+            }
+        }
+    }
+    CHECK(oversized == 0);
+    CHECK(badColors == 0);
+    CHECK(specials > cells / 20 && specials < cells * 3 / 20);
+
+    BoardSpec twoColors;
+    twoColors.colorCount = 2;
+    ColorGrid grid(twoColors.rows, twoColors.columns, &arena);
+    CHECK(!generator.generate(twoColors, rng, grid));
+
+    for (int level = 1; level <= 5; level++) {
+        BubbleSim sim(testConfig(static_cast<uint64_t>(level)));
+        InputState input{};
+        input.command = COMMAND_START_LEVEL;
+        input.commandLevel = level;
+        sim.tick(input, 1.0f / 60.0f);
+        CHECK(sim.getBallCount() == static_cast<size_t>(sim.getLevels()[static_cast<size_t>(level) - 1].ballCount));
+    }
+}
+
+static void testLevelTransitionMatchesReplay() {
+    BubbleSim sim(testConfig(18));
+    BotSession bot(1, 18);
+    play(sim, bot, 2);
+
+    // Bots rarely score enough to finish a level, so start one point short.
+    std::vector<uint8_t> nearlyDone;
+    sim.saveState(nearlyDone, false);
+    SaveStateHeader header;
+    std::memcpy(&header, nearlyDone.data(), sizeof(header));
+    header.score = sim.getLevels()[0].targetScore - 1;
+    std::memcpy(nearlyDone.data(), &header, sizeof(header));
+    CHECK(sim.loadState(nearlyDone.data(), nearlyDone.size()));
+
+    std::vector<uint8_t> beforeTransition;
+    std::vector<uint8_t> afterTransition;
+    InputState transitionInput{};
+
+    for (int i = 0; i < 20000 && afterTransition.empty(); i++) {
+        InputState input = bot.next(sim);
+        std::vector<uint8_t> before;
+        sim.saveState(before, false);
+        int level = sim.getCurrentLevel();
+
+        sim.tick(input, 1.0f / 60.0f);
+        if (sim.getCurrentLevel() == level + 1 && sim.getGameState() == PLAYING) {
+            beforeTransition = std::move(before);
+            transitionInput = input;
+            sim.saveState(afterTransition, false);
+        }
+    }
+    CHECK(!afterTransition.empty());
+    if (afterTransition.empty()) return;
+
+    // The replay only starts building the next board when the state is
+    // loaded, so its transition may have to wait for or redo the build.
+    BubbleSim replay(testConfig(19));
+    CHECK(replay.loadState(beforeTransition.data(), beforeTransition.size()));
+    replay.tick(transitionInput, 1.0f / 60.0f);
+
+    std::vector<uint8_t> replayed;
+    replay.saveState(replayed, false);
+    CHECK(replayed == afterTransition);
+    CHECK(replay.getBallCount() == static_cast<size_t>(replay.getLevels()[1].ballCount));
+}
+
+// Compares positions in sorted order; the sim may reorder balls between ticks.
+static float largestStep(const RenderSnapshot& before, const RenderSnapshot& after) {
+    auto sortedPositions = [](const RenderSnapshot& snapshot) {
+        std::vector<std::pair<float, float>> positions;
+        for (const BallView& ball : snapshot.balls) {
+            positions.push_back({ ball.position.x, ball.position.y });
+        }
+        std::sort(positions.begin(), positions.end());
+        return positions;
+    };
+    std::vector<std::pair<float, float>> from = sortedPositions(before);
+    std::vector<std::pair<float, float>> to = sortedPositions(after);
+
+    float largest = 0.0f;
+    for (size_t i = 0; i < from.size() && i < to.size(); i++) {
+        largest = std::max(largest, std::fabs(to[i].first - from[i].first) +
+            std::fabs(to[i].second - from[i].second));
+    }
+    return largest;
+}
+
+static void testConstraintSolverSettles() {
+    SimConfig config = testConfig(15);
+    config.solver = SOLVER_PBD;
+    BubbleSim sim(config);
+
+    InputState input{};
+    input.command = COMMAND_START_LEVEL;
+    input.commandLevel = 5;
+    input.mousePosition = { 225.0f, 600.0f };
+    sim.tick(input, 1.0f / 60.0f);
+
+    RenderSnapshot before;
+    RenderSnapshot after;
+    sim.fillSnapshot(before);
+    int movingTicks = 0;
+
+    InputState idle{};
+    idle.mousePosition = input.mousePosition;
+    for (int i = 0; i < 300; i++) {
+        sim.tick(idle, 1.0f / 60.0f);
+        sim.fillSnapshot(after);
+        if (i >= 120 && largestStep(before, after) > 0.0f) movingTicks++;
+        std::swap(before, after);
+    }
+    CHECK(movingTicks == 0);
+
+    BotSession bot(5, 15);
+    play(sim, bot, 2000);
+    CHECK(sim.getScore() > 0);
+}
+
+static void testSpscQueueKeepsOrder() {
+    SpscQueue<int, 64> queue;
+    const int count = 20000;
+
+    std::thread producer([&queue]() {
+        for (int i = 0; i < count; i++) {
+            while (!queue.push(i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    int expected = 0;
+    bool ordered = true;
+    while (expected < count) {
+        int value;
+        if (queue.pop(value)) {
+            ordered = ordered && value == expected;
+            expected++;
+        }
+    }
+    producer.join();
+    CHECK(ordered);
+}
+
+struct Counter {
+    int value = 0;
+};
+
+static void testTripleBufferNeverGoesBack() {
+    TripleBuffer<Counter> buffer;
+    const int count = 20000;
+
+    std::thread writer([&buffer]() {
+        for (int i = 1; i <= count; i++) {
+            buffer.writeSlot().value = i;
+            buffer.publish();
+        }
+    });
+
+    int last = 0;
+    bool monotonic = true;
+    while (last < count) {
+        int value = buffer.read().value;
+        monotonic = monotonic && value >= last;
+        last = value;
+    }
+    writer.join();
+    CHECK(monotonic);
+}
+
+int main() {
+    testStartLevel();
+    testSaveStateRoundTrip();
+    testRestoredSessionsStayInLockstep();
+    testRejectsCorruptState();
+    testRewindReconstructsPastTicks();
+    testRewindStaysWithinBudget();
+    testUndoKeepsRecentShots();
+    testEventsDriveScoring();
+    testAudioCascadeUsesFixedVoices();
+    testAudioFollowsSimEvents();
+    testTelemetryWritesSessionRecords();
+    testTraceWritesBalancedSpans();
+    testInputLatencyClosesOnPresent();
+    testFramePacerHoldsRate();
+    testQualityStepsWithFrameTime();
+    testColorKernelsMatchScalar();
+    testColorCountsFollowTheBoard();
+    testConstraintSolverSettles();
+    testReorderKeepsRewindAndCounts();
+    testBoardsHaveNoOpeningMatches();
+    testLevelTransitionMatchesReplay();
+    testSpscQueueKeepsOrder();
+    testTripleBufferNeverGoesBack();
+
+    if (failures > 0) {
+        std::printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    std::printf("All checks passed\n");
+    return 0;
+}